@@ -0,0 +1,739 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Vector artwork import.  Both formats are reduced to polylines in the artwork's own units first, so that the
+ placement on screen can be decided once everything is known; then each polyline goes through fit_polyline(),
+ which covers it with the fewest lines and masked arcs within tolerance, and the optimizer drops whatever
+ duplicates and mergeable lines are left.
+
+ SVG support covers path data (M L H V C S Q T Z, absolute and relative).  Elliptical arc commands and transform
+ attributes aren't handled; flatten them in the drawing program before exporting.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "art_import.h"
+#include "dl_optimize.h"
+
+void art_paths_init(art_paths *paths){
+  memset(paths, 0, sizeof(*paths));
+}
+
+void art_paths_free(art_paths *paths){
+  free(paths->pts);
+  free(paths->starts);
+  art_paths_init(paths);
+}
+
+static int push_point(art_paths *paths, vc_point pt){
+  if(paths->n_pts == paths->pts_capacity){
+    int capacity = paths->pts_capacity ? 2 * paths->pts_capacity : 256;
+    vc_point *pts = realloc(paths->pts, capacity * sizeof(vc_point));
+
+    if(!pts) return -1;
+    paths->pts = pts;
+    paths->pts_capacity = capacity;
+  }
+  paths->pts[paths->n_pts++] = pt;
+  return 0;
+}
+
+static int begin_path(art_paths *paths, vc_point pt){
+  if(paths->n_paths == paths->paths_capacity){
+    int capacity = paths->paths_capacity ? 2 * paths->paths_capacity : 32;
+    int *starts = realloc(paths->starts, capacity * sizeof(int));
+
+    if(!starts) return -1;
+    paths->starts = starts;
+    paths->paths_capacity = capacity;
+  }
+  paths->starts[paths->n_paths++] = paths->n_pts;
+  return push_point(paths, pt);
+}
+
+// a path that never got past its first point draws nothing, so it's dropped:
+static void end_path(art_paths *paths){
+  if(paths->n_paths && paths->n_pts - paths->starts[paths->n_paths - 1] < 2){
+    paths->n_pts = paths->starts[paths->n_paths - 1];
+    paths->n_paths--;
+  }
+}
+
+static int path_length(art_paths *paths, int i){
+  int end = (i + 1 < paths->n_paths) ? paths->starts[i + 1] : paths->n_pts;
+
+  return end - paths->starts[i];
+}
+
+// the pen moves from *cur to pt, starting a new path at *cur if one isn't already open:
+static int draw_to(art_paths *paths, int *open, vc_point *cur, vc_point pt){
+  if(!*open){
+    if(begin_path(paths, *cur)) return -1;
+    *open = 1;
+  }
+  *cur = pt;
+  return push_point(paths, pt);
+}
+
+static int draw_bezier(art_paths *paths, int *open, vc_point *cur, vc_point c1, vc_point c2, vc_point end, float flatness){
+  vc_point pts[BEZIER_MAX_POINTS];
+  int n = bezier_points(*cur, c1, c2, end, flatness, pts), k;
+
+  for(k = 1; k < n; k++)
+    if(draw_to(paths, open, cur, pts[k])) return -1;
+  return 0;
+}
+
+static void skip_separators(const char **p){
+  while(**p && (isspace((unsigned char)**p) || **p == ','))
+    (*p)++;
+}
+
+// reads n numbers, or leaves *p alone and returns -1 if they aren't all there:
+static int read_numbers(const char **p, float *v, int n){
+  const char *q = *p;
+  int i;
+
+  for(i = 0; i < n; i++){
+    char *end;
+
+    skip_separators(&q);
+    v[i] = strtof(q, &end);
+    if(end == q) return -1;
+    q = end;
+  }
+  *p = q;
+  return 0;
+}
+
+static vc_point reflect(vc_point ctrl, vc_point about){
+  vc_point result = {2 * about.x - ctrl.x, 2 * about.y - ctrl.y};
+  return result;
+}
+
+int parse_svg_path(const char *d, float flatness, art_paths *paths){
+  vc_point cur = {0, 0}, start = {0, 0}, ctrl = {0, 0};   // ctrl is the last control point, for S and T
+  char cmd = 0, prev = 0;
+  int open = 0;
+  const char *p = d;
+
+  for(;;){
+    float v[6];
+    vc_point base, c1, c2, end;
+    int relative;
+
+    skip_separators(&p);
+    if(!*p) break;
+    if(isalpha((unsigned char)*p))
+      cmd = *p++;
+    else if(!cmd)
+      return -1;    // numbers with no command to repeat
+
+    relative = islower((unsigned char)cmd);
+    base = relative ? cur : (vc_point){0, 0};
+
+    switch(toupper((unsigned char)cmd)){
+    case 'Z':
+      if(open && draw_to(paths, &open, &cur, start)) return -1;
+      end_path(paths);
+      open = 0;
+      cur = start;
+      cmd = 0;      // Z takes no numbers, so nothing can repeat it
+      prev = 'Z';
+      continue;
+    case 'M':
+      if(read_numbers(&p, v, 2)) return -1;
+      end_path(paths);
+      open = 0;
+      cur.x = base.x + v[0];
+      cur.y = base.y + v[1];
+      start = cur;
+      cmd = relative ? 'l' : 'L';   // further coordinate pairs are line-tos
+      break;
+    case 'L':
+      if(read_numbers(&p, v, 2)) return -1;
+      end.x = base.x + v[0];
+      end.y = base.y + v[1];
+      if(draw_to(paths, &open, &cur, end)) return -1;
+      break;
+    case 'H':
+      if(read_numbers(&p, v, 1)) return -1;
+      end.x = base.x + v[0];
+      end.y = cur.y;
+      if(draw_to(paths, &open, &cur, end)) return -1;
+      break;
+    case 'V':
+      if(read_numbers(&p, v, 1)) return -1;
+      end.x = cur.x;
+      end.y = base.y + v[0];
+      if(draw_to(paths, &open, &cur, end)) return -1;
+      break;
+    case 'C':
+    case 'S':
+      if(toupper((unsigned char)cmd) == 'C'){
+        if(read_numbers(&p, v, 6)) return -1;
+        c1.x = base.x + v[0];
+        c1.y = base.y + v[1];
+        memmove(v, v + 2, 4 * sizeof(float));
+      }
+      else{
+        if(read_numbers(&p, v, 4)) return -1;
+        c1 = (prev == 'C' || prev == 'S') ? reflect(ctrl, cur) : cur;
+      }
+      c2.x = base.x + v[0];
+      c2.y = base.y + v[1];
+      end.x = base.x + v[2];
+      end.y = base.y + v[3];
+      if(draw_bezier(paths, &open, &cur, c1, c2, end, flatness)) return -1;
+      ctrl = c2;
+      break;
+    case 'Q':
+    case 'T':{
+      vc_point q, from = cur;
+
+      if(toupper((unsigned char)cmd) == 'Q'){
+        if(read_numbers(&p, v, 4)) return -1;
+        q.x = base.x + v[0];
+        q.y = base.y + v[1];
+        end.x = base.x + v[2];
+        end.y = base.y + v[3];
+      }
+      else{
+        if(read_numbers(&p, v, 2)) return -1;
+        q = (prev == 'Q' || prev == 'T') ? reflect(ctrl, cur) : cur;
+        end.x = base.x + v[0];
+        end.y = base.y + v[1];
+      }
+      // a quadratic is the cubic with its control points 2/3 of the way to q:
+      c1.x = from.x + 2.0f / 3.0f * (q.x - from.x);
+      c1.y = from.y + 2.0f / 3.0f * (q.y - from.y);
+      c2.x = end.x + 2.0f / 3.0f * (q.x - end.x);
+      c2.y = end.y + 2.0f / 3.0f * (q.y - end.y);
+      if(draw_bezier(paths, &open, &cur, c1, c2, end, flatness)) return -1;
+      ctrl = q;
+      break;
+    }
+    default:
+      return -1;    // including A, which we don't do
+    }
+    prev = toupper((unsigned char)cmd);
+  }
+  end_path(paths);
+  return 0;
+}
+
+int parse_svg_file(const char *svg, float flatness, art_paths *paths){
+  const char *tag = svg;
+
+  while((tag = strstr(tag, "<path")) != NULL){
+    const char *tag_end = strchr(tag, '>');
+    const char *attr = tag;
+
+    if(!tag_end) return -1;
+    // find the d attribute, which is d= preceded by white space:
+    while((attr = strstr(attr + 1, "d=")) != NULL && attr < tag_end){
+      if(isspace((unsigned char)attr[-1]) && (attr[2] == '"' || attr[2] == '\'')){
+        const char *value = attr + 3;
+        const char *value_end = strchr(value, attr[2]);
+        char *d;
+        int result;
+
+        if(!value_end) return -1;
+        d = malloc(value_end - value + 1);
+        if(!d) return -1;
+        memcpy(d, value, value_end - value);
+        d[value_end - value] = 0;
+        result = parse_svg_path(d, flatness, paths);
+        free(d);
+        if(result) return result;
+        break;
+      }
+    }
+    tag = tag_end;
+  }
+  return 0;
+}
+
+int parse_hpgl(const char *hpgl, art_paths *paths){
+  vc_point cur = {0, 0};
+  int pen_down = 0, relative = 0, open = 0;
+  const char *p = hpgl;
+
+  for(;;){
+    char c0, c1;
+    float v[2];
+
+    while(*p && (isspace((unsigned char)*p) || *p == ';' || *p == ','))
+      p++;
+    if(!*p) break;
+    if(!isalpha((unsigned char)p[0]) || !isalpha((unsigned char)p[1])) return -1;
+    c0 = toupper((unsigned char)p[0]);
+    c1 = toupper((unsigned char)p[1]);
+    p += 2;
+
+    if(c0 == 'I' && c1 == 'N'){
+      pen_down = relative = 0;
+      cur.x = cur.y = 0;
+    }
+    else if(c0 == 'P' && c1 == 'U')
+      pen_down = 0;
+    else if(c0 == 'P' && c1 == 'D')
+      pen_down = 1;
+    else if(c0 == 'P' && c1 == 'A')
+      relative = 0;
+    else if(c0 == 'P' && c1 == 'R')
+      relative = 1;
+    else{
+      // anything else (pen select, line type..) doesn't change what's drawn.  Labels run to ETX:
+      char terminator = (c0 == 'L' && c1 == 'B') ? '\003' : ';';
+
+      while(*p && *p != terminator)
+        p++;
+      if(*p) p++;
+      continue;
+    }
+
+    if(!pen_down && open){
+      end_path(paths);
+      open = 0;
+    }
+    // PU, PD, PA and PR can all carry coordinate pairs, which move or draw according to the pen:
+    while(!read_numbers(&p, v, 2)){
+      vc_point pt = {relative ? cur.x + v[0] : v[0], relative ? cur.y + v[1] : v[1]};
+
+      if(pen_down){
+        if(draw_to(paths, &open, &cur, pt)) return -1;
+      }
+      else
+        cur = pt;
+    }
+  }
+  end_path(paths);
+  return 0;
+}
+
+void art_fit_to_screen(art_paths *paths, int flip_y, int margin, float tolerance, art_placement *placement){
+  float min_x = 0, max_x = 0, min_y = 0, max_y = 0, extent;
+  int i;
+
+  for(i = 0; i < paths->n_pts; i++){
+    vc_point pt = paths->pts[i];
+
+    if(i == 0 || pt.x < min_x) min_x = pt.x;
+    if(i == 0 || pt.x > max_x) max_x = pt.x;
+    if(i == 0 || pt.y < min_y) min_y = pt.y;
+    if(i == 0 || pt.y > max_y) max_y = pt.y;
+  }
+  extent = (max_x - min_x > max_y - min_y) ? max_x - min_x : max_y - min_y;
+
+  placement->scale = extent > 0 ? (254 - 2 * margin) / extent : 1.0f;
+  placement->dx = 127 - placement->scale * (min_x + max_x) / 2;
+  placement->dy = flip_y ? 127 + placement->scale * (min_y + max_y) / 2 : 127 - placement->scale * (min_y + max_y) / 2;
+  placement->flip_y = flip_y;
+  placement->tolerance = tolerance;
+}
+
+int fit_art(art_paths *paths, art_placement *placement, int which_buffer){
+  display_list *dl = &display_lists[which_buffer];
+  int i, k;
+
+  for(i = 0; i < paths->n_paths; i++){
+    int n = path_length(paths, i);
+    vc_point *src = paths->pts + paths->starts[i];
+    vc_point *placed = malloc(n * sizeof(vc_point));
+
+    if(!placed) return -1;
+    for(k = 0; k < n; k++){
+      placed[k].x = src[k].x * placement->scale + placement->dx;
+      placed[k].y = placement->flip_y ? placement->dy - src[k].y * placement->scale : src[k].y * placement->scale + placement->dy;
+    }
+    fit_polyline(placed, n, placement->tolerance, which_buffer);
+    free(placed);
+  }
+  optimize_display_list(dl);
+  return dl->length;
+}
+
+int save_display_list(const char *path, display_list *dl){
+  unsigned char header[12] = {'V', 'C', 'D', 'L', VCDL_VERSION, 0, 0, 0};
+  FILE *f = fopen(path, "wb");
+  int ok;
+
+  if(!f) return -1;
+  header[8] = dl->length & 0xff;
+  header[9] = (dl->length >> 8) & 0xff;
+  header[10] = (dl->length >> 16) & 0xff;
+  header[11] = (dl->length >> 24) & 0xff;
+  ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+       fwrite(dl->segs, sizeof(seg_or_flag), dl->length + 1, f) == (size_t)dl->length + 1;  // sentinel included
+  return (fclose(f) == 0 && ok) ? 0 : -1;
+}
+
+int load_display_list(const char *path, static_art *art){
+  unsigned char header[12];
+  seg_or_flag *segs;
+  FILE *f = fopen(path, "rb");
+  unsigned long length;
+
+  if(!f) return -1;
+  if(fread(header, sizeof(header), 1, f) != 1 || memcmp(header, "VCDL", 4) || header[4] != VCDL_VERSION){
+    fclose(f);
+    return -1;
+  }
+  length = header[8] | (header[9] << 8) | ((unsigned long)header[10] << 16) | ((unsigned long)header[11] << 24);
+  if(length > MAX_BUF_ENTRIES || !(segs = malloc((length + 1) * sizeof(seg_or_flag)))){
+    fclose(f);
+    return -1;
+  }
+  if(fread(segs, sizeof(seg_or_flag), length + 1, f) != length + 1 || segs[length].flag != 0xff){
+    free(segs);
+    fclose(f);
+    return -1;
+  }
+  fclose(f);
+  art->segs = segs;
+  art->length = length;
+  return 0;
+}
+
+void write_art_source(FILE *f, const char *name, display_list *dl){
+  static const char *shape_names[] = {"cir", "legacy_pos", "legacy_neg", "pos", "neg", "lissajou0", "lissajou1",
+                                      "lissajou2", "lissajou3", "lissajou4", "lissajou5"};
+  int i;
+
+  if(!dl->length){
+    fprintf(f, "// %s: no segments\n", name);
+    return;
+  }
+  fprintf(f, "STATIC_ART(%s,\n", name);
+  for(i = 0; i < dl->length; i++){
+    vc_segment *seg = &dl->segs[i].seg_data;
+
+    fprintf(f, "           SEG_SHAPE(%d, %d, %d, %d, %s, 0x%02x)%s\n", seg->x_offset, seg->y_offset, seg->x_size,
+            seg->y_size, seg->arc_type <= lissajou5 ? shape_names[seg->arc_type] : "cir", seg->mask,
+            i + 1 < dl->length ? "," : ");");
+  }
+}
+
+// the next character of a record, which may carry on over a line break:
+static int hershey_char(const char **p){
+  while(**p == '\n' || **p == '\r')
+    (*p)++;
+  return **p ? (unsigned char)*(*p)++ : -1;
+}
+
+int parse_hershey_glyph(const char **p, int *number, int *left, int *right, art_paths *paths){
+  char field[9];
+  int n_pairs, open = 0, i;
+
+  // the number field is padded with spaces, so only line breaks are skipped between records:
+  while(**p == '\n' || **p == '\r')
+    (*p)++;
+  if(!**p) return 0;
+  for(i = 0; i < 8; i++){
+    int c = hershey_char(p);
+
+    if(c < 0) return -1;
+    field[i] = c;
+  }
+  field[8] = 0;
+  n_pairs = atoi(field + 5);
+  field[5] = 0;
+  *number = atoi(field);
+  if(n_pairs < 1) return -1;
+
+  for(i = 0; i < n_pairs; i++){
+    int c0 = hershey_char(p), c1 = hershey_char(p);
+    vc_point pt;
+
+    if(c0 < 0 || c1 < 0) return -1;
+    if(i == 0){
+      *left = c0 - 'R';
+      *right = c1 - 'R';
+    }
+    else if(c0 == ' ' && c1 == 'R'){
+      end_path(paths);
+      open = 0;
+    }
+    else{
+      pt.x = c0 - 'R';
+      pt.y = c1 - 'R';
+      if(open ? push_point(paths, pt) : begin_path(paths, pt)) return -1;
+      open = 1;
+    }
+  }
+  end_path(paths);
+  return 1;
+}
+
+typedef struct {
+  vcf_glyph entry;
+  seg_or_flag *segs;      // the glyph's segments and end flag
+} hershey_glyph;
+
+static int by_codepoint(const void *a, const void *b){
+  uint32_t ca = ((const hershey_glyph *)a)->entry.codepoint, cb = ((const hershey_glyph *)b)->entry.codepoint;
+  return ca < cb ? -1 : ca > cb;
+}
+
+int write_hershey_font(const char *jhf, const char *path, long first_codepoint, float scale, float tolerance){
+  display_list *dl = &display_lists[MAIN_BUFFER];
+  hershey_glyph *glyphs = NULL;
+  vcf_header header;
+  art_paths paths;
+  const char *p = jhf;
+  int n_glyphs = 0, capacity = 0, number, left, right, result = -1, i;
+  uint32_t n_segs = 0;
+  FILE *f;
+
+  art_paths_init(&paths);
+  for(;;){
+    // Hershey y runs from about -16 (top) to 16 (bottom of the descenders), which go at the y the string is drawn at:
+    art_placement placement = {scale, 0, 16 * scale, 1, tolerance};
+    hershey_glyph *glyph;
+    int width, r;
+
+    art_paths_free(&paths);
+    if((r = parse_hershey_glyph(&p, &number, &left, &right, &paths)) <= 0){
+      if(r == 0) break;
+      goto done;
+    }
+    placement.dx = -left * scale;
+    dl_clear(dl);
+    if(fit_art(&paths, &placement, MAIN_BUFFER) < 0) goto done;
+    width = (int)((right - left) * scale + 0.5f);
+    if(dl->length > 255 || width < 0 || width > 255){
+      fprintf(stderr, "Hershey glyph %d is too big for a font, skipped\n", number);
+      continue;
+    }
+
+    if(n_glyphs == capacity){
+      hershey_glyph *grown = realloc(glyphs, (capacity = capacity ? 2 * capacity : 128) * sizeof(hershey_glyph));
+
+      if(!grown) goto done;
+      glyphs = grown;
+    }
+    glyph = &glyphs[n_glyphs];
+    if(!(glyph->segs = malloc((dl->length + 1) * sizeof(seg_or_flag)))) goto done;
+    memcpy(glyph->segs, dl->segs, dl->length * sizeof(seg_or_flag));
+    glyph->segs[dl->length].flag = 0x80 | (width < 0x7f ? width : 0x7f);   // the full width is in the index
+    glyph->entry.codepoint = first_codepoint < 0 ? (uint32_t)number : (uint32_t)(first_codepoint + n_glyphs);
+    glyph->entry.width = width;
+    glyph->entry.n_segs = dl->length;
+    glyph->entry.reserved = 0;
+    n_glyphs++;
+  }
+  qsort(glyphs, n_glyphs, sizeof(hershey_glyph), by_codepoint);
+  for(i = 0; i < n_glyphs; i++){
+    glyphs[i].entry.offset = n_segs;
+    n_segs += glyphs[i].entry.n_segs + 1;
+  }
+
+  // the sidebearings are part of each glyph's width, so characters need no extra space between them:
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "VCFN", 4);
+  header.version = VCF_VERSION;
+  header.n_glyphs = n_glyphs;
+  header.n_segs = n_segs;
+  if(!(f = fopen(path, "wb"))) goto done;
+  result = fwrite(&header, sizeof(header), 1, f) == 1 ? n_glyphs : -1;
+  for(i = 0; i < n_glyphs && result >= 0; i++)
+    if(fwrite(&glyphs[i].entry, sizeof(vcf_glyph), 1, f) != 1) result = -1;
+  for(i = 0; i < n_glyphs && result >= 0; i++)
+    if(fwrite(glyphs[i].segs, sizeof(seg_or_flag), glyphs[i].entry.n_segs + 1, f) != (size_t)glyphs[i].entry.n_segs + 1)
+      result = -1;
+  if(fclose(f)) result = -1;
+
+done:
+  for(i = 0; i < n_glyphs; i++)
+    free(glyphs[i].segs);
+  free(glyphs);
+  art_paths_free(&paths);
+  return result;
+}
+
+// The offline converter.  Build it with
+//   cc -DIMPORT_ART_MAIN -o import_art art_import.c curve_fit.c draw.c font.c seg_kernels.c dl_optimize.c -lm
+// and run it as
+//   import_art [-t tolerance] [-s scale -x dx -y dy] [-m margin] [-f|-F] [-o out.vcdl] [-c out.c] [-n name] art.svg|art.hpgl
+// Without -s the artwork is centered and scaled to fill the screen.  SVG is flipped to our y-up axis unless -F says
+// not to; HPGL is already y-up, so it's only flipped with -f.  Given a Hershey font,
+//   import_art [-t tolerance] [-s scale] [-b first_codepoint | -u] -o out.vcf font.jhf
+// writes a loadable font instead, at scale 1 unless -s says otherwise.  Glyphs are numbered from -b (32 by
+// default) in file order, or -u keeps their Hershey numbers as code points.  import_art -T runs the regression
+// checks below, and exits non-zero if any fail.
+#ifdef IMPORT_ART_MAIN
+#include <unistd.h>
+#include <strings.h>
+
+static char *read_file(const char *path){
+  FILE *f = fopen(path, "rb");
+  char *text = NULL;
+  long size;
+
+  if(!f) return NULL;
+  if(fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0 && (text = malloc(size + 1))){
+    if(fread(text, 1, size, f) != (size_t)size){
+      free(text);
+      text = NULL;
+    }
+    else
+      text[size] = 0;
+  }
+  fclose(f);
+  return text;
+}
+
+static int ends_with(const char *s, const char *suffix){
+  size_t n = strlen(s), k = strlen(suffix);
+  return n >= k && !strcasecmp(s + n - k, suffix);
+}
+
+static int parse_art(const char *text, int is_svg, float flatness, art_paths *paths){
+  art_paths_free(paths);
+  return is_svg ? parse_svg_file(text, flatness, paths) : parse_hpgl(text, paths);
+}
+
+// A circle drawn as four cubics has to come out as one fully lit arc, whether it's placed as drawn or fit to the
+// screen.  Returns the number of checks that failed:
+static int self_test(void){
+  static const char circle_path[] = "M150,100 C150,72.386 172.386,50 200,50 C227.614,50 250,72.386 250,100 "
+                                    "C250,127.614 227.614,150 200,150 C172.386,150 150,127.614 150,100 Z";
+  display_list *dl = &display_lists[MAIN_BUFFER];
+  art_placement placement = {1.0f, 0.0f, 207.0f, 1, 1.0f};
+  art_paths paths;
+  int pass, failures = 0;
+
+  art_paths_init(&paths);
+  for(pass = 0; pass < 2; pass++){
+    art_paths_free(&paths);
+    if(pass == 1){
+      parse_svg_path(circle_path, 1.0f, &paths);
+      art_fit_to_screen(&paths, 1, 4, 1.0f, &placement);
+      art_paths_free(&paths);
+    }
+    parse_svg_path(circle_path, placement.tolerance / (2 * placement.scale), &paths);
+    dl_clear(dl);
+    fit_art(&paths, &placement, MAIN_BUFFER);
+    if(dl->length != 1 || dl->segs[0].seg_data.arc_type != cir || dl->segs[0].seg_data.mask != 0xff){
+      fprintf(stderr, "FAILED: circle %s imports as %d segments\n", pass ? "fit to the screen" : "as drawn", dl->length);
+      failures++;
+    }
+  }
+  art_paths_free(&paths);
+  fprintf(stderr, "%s\n", failures ? "self test failed" : "self test passed");
+  return failures;
+}
+
+int main(int argc, char *argv[]){
+  float tolerance = 1.0f, scale = 0, dx = 0, dy = 0;
+  int margin = 4, flip = -1, is_svg, opt, n_segs, n_glyphs, hershey_numbers = 0;
+  long first_codepoint = 32;
+  const char *vcdl_path = NULL, *source_path = NULL, *name = "imported_art";
+  art_placement placement;
+  art_paths paths;
+  char *text;
+
+  while((opt = getopt(argc, argv, "t:s:x:y:m:fFo:c:n:ub:T")) != -1){
+    switch(opt){
+    case 't': tolerance = atof(optarg); break;
+    case 's': scale = atof(optarg); break;
+    case 'x': dx = atof(optarg); break;
+    case 'y': dy = atof(optarg); break;
+    case 'm': margin = atoi(optarg); break;
+    case 'f': flip = 1; break;
+    case 'F': flip = 0; break;
+    case 'o': vcdl_path = optarg; break;
+    case 'c': source_path = optarg; break;
+    case 'n': name = optarg; break;
+    case 'u': hershey_numbers = 1; break;
+    case 'b': first_codepoint = atol(optarg); break;
+    case 'T': return self_test() ? 1 : 0;
+    default:
+      fprintf(stderr, "usage: %s [-t tolerance] [-s scale -x dx -y dy] [-m margin] [-f|-F] [-o out.vcdl] [-c out.c] [-n name] file\n"
+              "       %s [-t tolerance] [-s scale] [-b first_codepoint | -u] -o out.vcf font.jhf\n", argv[0], argv[0]);
+      return 1;
+    }
+  }
+  if(optind >= argc || !(text = read_file(argv[optind]))){
+    fprintf(stderr, "%s: can't read %s\n", argv[0], optind < argc ? argv[optind] : "(no input file)");
+    return 1;
+  }
+  if(ends_with(argv[optind], ".jhf")){
+    if(!vcdl_path){
+      fprintf(stderr, "%s: a font needs -o out.vcf\n", argv[0]);
+      return 1;
+    }
+    if((n_glyphs = write_hershey_font(text, vcdl_path, hershey_numbers ? -1 : first_codepoint, scale > 0 ? scale : 1.0f,
+                                    tolerance)) < 0){
+      fprintf(stderr, "%s: can't convert %s to %s\n", argv[0], argv[optind], vcdl_path);
+      return 1;
+    }
+    fprintf(stderr, "%d glyphs\n", n_glyphs);
+    free(text);
+    return 0;
+  }
+  is_svg = ends_with(argv[optind], ".svg") || strstr(text, "<svg") != NULL;
+  if(flip < 0) flip = is_svg;
+
+  art_paths_init(&paths);
+  if(scale > 0){
+    placement.scale = scale;
+    placement.dx = dx;
+    placement.dy = dy;
+    placement.flip_y = flip;
+    placement.tolerance = tolerance;
+  }
+  else{
+    // a first pass to find the extent, and so the scale curves need to be sampled at:
+    if(parse_art(text, is_svg, 1.0f, &paths) || !paths.n_pts){
+      fprintf(stderr, "%s: no usable paths in %s\n", argv[0], argv[optind]);
+      return 1;
+    }
+    art_fit_to_screen(&paths, flip, margin, tolerance, &placement);
+  }
+  // sample curves finely enough that the fitter, not the sampling, sets the error:
+  if(parse_art(text, is_svg, tolerance / (2 * placement.scale), &paths)){
+    fprintf(stderr, "%s: syntax error in %s\n", argv[0], argv[optind]);
+    return 1;
+  }
+
+  dl_clear(&display_lists[MAIN_BUFFER]);
+  n_segs = fit_art(&paths, &placement, MAIN_BUFFER);
+  fprintf(stderr, "%d paths, %d points -> %d segments (scale %.4f, tolerance %.2f)\n", paths.n_paths, paths.n_pts,
+          n_segs, placement.scale, placement.tolerance);
+
+  if(vcdl_path && save_display_list(vcdl_path, &display_lists[MAIN_BUFFER])){
+    fprintf(stderr, "%s: can't write %s\n", argv[0], vcdl_path);
+    return 1;
+  }
+  if(source_path){
+    FILE *f = fopen(source_path, "w");
+
+    if(!f){
+      fprintf(stderr, "%s: can't write %s\n", argv[0], source_path);
+      return 1;
+    }
+    write_art_source(f, name, &display_lists[MAIN_BUFFER]);
+    fclose(f);
+  }
+  else if(!vcdl_path)
+    write_art_source(stdout, name, &display_lists[MAIN_BUFFER]);
+
+  art_paths_free(&paths);
+  free(text);
+  return 0;
+}
+#endif
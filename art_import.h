@@ -0,0 +1,80 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Imports vector artwork -- SVG path data and HPGL plotter files -- and fits it to native segments.  Also reads and
+ writes binary display list files, writes art out as C source for STATIC_ART, and converts Hershey fonts to
+ loadable .vcf fonts.
+*/
+
+#ifndef art_import_h
+#define art_import_h
+
+#include <stdio.h>
+#include "draw.h"
+#include "curve_fit.h"
+
+// Imported paths, in the artwork's own units, as polylines laid end to end.  Curves are already sampled:
+typedef struct {
+  vc_point *pts;
+  int n_pts, pts_capacity;
+  int *starts;      // index in pts of each path's first point
+  int n_paths, paths_capacity;
+} art_paths;
+
+// how artwork units map onto the screen: x' = x * scale + dx, and y' = y * scale + dy, or dy - y * scale if
+// flip_y is set (SVG's y axis points down, ours points up).  tolerance is in screen pixels:
+typedef struct {
+  float scale;
+  float dx, dy;
+  int flip_y;
+  float tolerance;
+} art_placement;
+
+void art_paths_init(art_paths *paths);
+void art_paths_free(art_paths *paths);
+
+// each returns 0, or -1 on a syntax error.  Curves are sampled to within flatness (in artwork units):
+int parse_svg_path(const char *d, float flatness, art_paths *paths);
+int parse_svg_file(const char *svg, float flatness, art_paths *paths);  // every <path d="..."> in a document
+int parse_hpgl(const char *hpgl, art_paths *paths);
+
+// a placement that centers the artwork on screen and scales it to fill all but margin pixels:
+void art_fit_to_screen(art_paths *paths, int flip_y, int margin, float tolerance, art_placement *placement);
+
+// fits every path to lines and arcs, appends them to which_buffer and optimizes the result.  Returns the
+// number of segments the buffer holds afterwards:
+int fit_art(art_paths *paths, art_placement *placement, int which_buffer);
+
+// Binary display list files: the 4 bytes "VCDL", a version byte, 3 reserved bytes, a little-endian 32-bit segment
+// count, and then the segments themselves, sentinel included, exactly as they sit in a display list.  Loading
+// reads them straight into place, with no parsing:
+#define VCDL_VERSION 1
+int save_display_list(const char *path, display_list *dl);
+int load_display_list(const char *path, static_art *art);   // art->segs is malloc'd; free((void *)art->segs)
+
+// writes the list as a STATIC_ART declaration:
+void write_art_source(FILE *f, const char *name, display_list *dl);
+
+// Hershey fonts.  A .jhf file has a record per glyph: a 5 character glyph number, a 3 character vertex count, then
+// that many coordinate pairs, each coordinate a character's offset from 'R'.  The first pair is the glyph's left
+// and right edges, and " R" lifts the pen; y points down.  Long records carry on over the next line.  Returns 1
+// with the glyph's strokes in paths, 0 at the end of the file, or -1 on a syntax error:
+int parse_hershey_glyph(const char **p, int *number, int *left, int *right, art_paths *paths);
+
+// converts every glyph in a .jhf file into a .vcf font (see font.h) at scale pixels per Hershey unit, and returns
+// the number of glyphs written, or -1.  Glyphs take code points from first_codepoint up in file order, or their
+// Hershey numbers if first_codepoint is negative:
+int write_hershey_font(const char *jhf, const char *path, long first_codepoint, float scale, float tolerance);
+
+#endif
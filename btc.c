@@ -32,6 +32,8 @@
 #undef USE_LOCKS
 char btc_price_str[64];
 char btc_title_str[64];
+volatile unsigned long btc_version = 0;
+static marquee btc_price_marquee;   // a big enough price is wider than the screen at this scale
 double btc_price_float;
 
 char btc_in_buf[1024];
@@ -74,6 +76,7 @@ void parse_btc_payload()
     btc_price_float = strtof(price_JSON->valuestring, NULL);
     sprintf(btc_price_str, "$%.2f", btc_price_float);
     debugMsg("Bitcoin at %s\n", btc_price_str);
+    btc_version++;
     cJSON_Delete(curl_JSON);
 }
 
@@ -134,11 +137,19 @@ void *btc_thread()
 }
 void render_BTC_price()
 {
-    compileString(btc_price_str, 255, 60, MAIN_BUFFER, 2, OVERWRITE);
+    clear_buffer(MAIN_BUFFER);
+    set_marquee(&btc_price_marquee, btc_price_str, 60, 2, 4, 251);
 
     btc_title_str[0] = (char)(106 + 32); // Bitcoin B
     btc_title_str[1] = 'T';
     btc_title_str[2] = 'C';
     btc_title_str[3] = (char)0;
     compileString(btc_title_str, 255, 166, MAIN_BUFFER, 3, APPEND);
+}
+
+// draws the price into AUX_BUFFER, every frame:
+void animate_BTC_price(unsigned long now_ms)
+{
+    clear_buffer(AUX_BUFFER);
+    draw_marquee(&btc_price_marquee, now_ms, AUX_BUFFER);
 }
\ No newline at end of file
@@ -15,7 +15,9 @@
 
 extern char btc_price_str[64];
 extern char btc_title_str[64];
+extern volatile unsigned long btc_version;    // bumped each time a new price is parsed
 
 void *btc_thread();
 void render_BTC_price();
+void animate_BTC_price(unsigned long now_ms);
 
@@ -0,0 +1,87 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Layer compositing: change tracking for the buffers the remote draws on top of each other.
+*/
+
+#include <stdio.h>
+#include "compositor.h"
+
+const int composite_order[N_COMPOSITE_LAYERS] = {MAIN_BUFFER, AUX_BUFFER, DEBUG_BUFFER};
+
+composite_layer composite_layers[N_BUFFERS] = {[MAIN_BUFFER] = {.shown = 1}};
+
+static const char *layer_names[N_BUFFERS] = {"main", "debug", "aux", "layer"};
+
+static uint64_t fnv1a(uint64_t hash, const uint8 *p, int n){
+  const uint8 *end = p + n;
+
+  while(p < end){
+    hash ^= *p++;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// FNV-1a over the segments, sentinel excluded, and then any text records:
+uint64_t dl_hash(display_list *dl){
+  uint64_t hash = fnv1a(0xcbf29ce484222325ULL, (const uint8 *)dl->segs, dl->length * sizeof(seg_or_flag));
+
+  return fnv1a(hash, dl->text, dl->text_length);
+}
+
+void show_layer(int which_buffer, int shown){
+  composite_layers[which_buffer].shown = shown;
+}
+
+int layer_needs_send(int which_buffer){
+  composite_layer *layer = &composite_layers[which_buffer];
+  display_list *dl = &display_lists[which_buffer];
+
+  if(!layer->shown)
+    clear_buffer(which_buffer);
+  if(dl->length == 0 && dl->text_length == 0 ? !layer->on_remote : (layer->on_remote && dl_hash(dl) == layer->sent_hash)){
+    layer->skips++;
+    return 0;
+  }
+  return 1;
+}
+
+void layer_sent(int which_buffer){
+  composite_layer *layer = &composite_layers[which_buffer];
+  display_list *dl = &display_lists[which_buffer];
+
+  layer->on_remote = dl->length != 0 || dl->text_length != 0;
+  layer->sent_hash = dl_hash(dl);
+  layer->sends++;
+}
+
+void layers_invalidate(void){
+  int i;
+
+  for(i = 0; i < N_BUFFERS; i++)
+    composite_layers[i].on_remote = 0;
+}
+
+void composite_report(void){
+  int i;
+
+  for(i = 0; i < N_COMPOSITE_LAYERS; i++){
+    int b = composite_order[i];
+    composite_layer *layer = &composite_layers[b];
+
+    printf("layer %s: %s, %lu sends, %lu skips\r\n", layer_names[b], layer->shown ? "shown" : "hidden", layer->sends,
+           layer->skips);
+  }
+}
@@ -0,0 +1,53 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Layer compositing.  The remote keeps a display list per buffer and draws MAIN_BUFFER, then AUX_BUFFER, then
+ DEBUG_BUFFER over it, so each layer can be redrawn and sent on its own.  A layer is only sent when its content
+ differs from what the remote already has, which is tracked by hashing the list as sent.
+*/
+
+#ifndef compositor_h
+#define compositor_h
+
+#include <stdint.h>
+#include "draw.h"
+
+// the buffers the remote draws, bottom to top:
+#define N_COMPOSITE_LAYERS 3
+extern const int composite_order[N_COMPOSITE_LAYERS];
+
+typedef struct {
+  int shown;            // a hidden layer is sent empty, once, and then left alone
+  int on_remote;        // nonzero if the remote holds a non-empty copy of this layer
+  uint64_t sent_hash;   // content hash of that copy
+  unsigned long sends, skips;
+} composite_layer;
+
+extern composite_layer composite_layers[N_BUFFERS];
+
+uint64_t dl_hash(display_list *dl);
+
+// MAIN_BUFFER starts out shown, the others hidden:
+void show_layer(int which_buffer, int shown);
+// returns 1 if the layer differs from the remote's copy.  Clears the buffer of a hidden layer:
+int layer_needs_send(int which_buffer);
+// the buffer has been copied to the remote:
+void layer_sent(int which_buffer);
+// forget what the remote holds, so every shown layer is sent again:
+void layers_invalidate(void);
+
+// prints sends and skips per layer:
+void composite_report(void);
+
+#endif
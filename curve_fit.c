@@ -0,0 +1,352 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Curve fitting onto the segments the hardware draws natively.
+
+ An arc segment is an axis-aligned ellipse with whole octants blanked, so a piece of curve can only become an arc
+ if it starts and ends on octant boundaries of some ellipse.  Given the two end points and a choice of boundaries
+ (a0, a1), the ellipse is fully determined:
+     Q - P = (rx * (cos a1 - cos a0), ry * (sin a1 - sin a0))
+ so we try every octant-aligned span, solve for rx, ry and the center, round to what a vc_segment can hold, and
+ measure how far the curve strays from the result.  fit_polyline() greedily takes the longest run of points that
+ either an arc or a single line covers within tolerance.
+
+ Arcs fit run by run don't always agree: the quarters of a circle can each come out with a slightly different
+ center.  So each new run is also offered to the arc before it, and if a single ellipse, fit by least squares to
+ both, covers them within tolerance, the two become one segment.  A closed circle or ellipse ends up as one
+ segment with every octant lit.
+*/
+
+#include <math.h>
+#include "curve_fit.h"
+
+#define ARC_MAX_POINTS 64       // longest run of points we'll try to cover with a single arc
+#define ARC_ANGLE_SLOP 0.05f    // radians a point may sit outside the arc's span and still count as on it
+#define BEZIER_MIN_STEPS 8
+
+static float point_dist(vc_point a, vc_point b){
+  return hypotf(a.x - b.x, a.y - b.y);
+}
+
+static float segment_dist(vc_point p, vc_point a, vc_point b){
+  float dx = b.x - a.x, dy = b.y - a.y;
+  float len2 = dx * dx + dy * dy;
+  float t = 0.0f;
+  vc_point nearest;
+
+  if(len2 > 0.0f){
+    t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2;
+    if(t < 0.0f)
+      t = 0.0f;
+    else if(t > 1.0f)
+      t = 1.0f;
+  }
+  nearest.x = a.x + t * dx;
+  nearest.y = a.y + t * dy;
+  return point_dist(p, nearest);
+}
+
+// true if the straight line from pts[i] to pts[j] passes within tolerance of every point in between:
+static int line_fits(const vc_point *pts, int i, int j, float tolerance){
+  int k;
+
+  for(k = i + 1; k < j; k++)
+    if(segment_dist(pts[k], pts[i], pts[j]) > tolerance)
+      return 0;
+  return 1;
+}
+
+// distance from p to the arc of the ellipse (cx, cy, rx, ry) between angles a0 and a1, or a large number if p
+// lies outside the arc's span:
+static float arc_dist(vc_point p, float cx, float cy, float rx, float ry, float a0, float a1){
+  float theta = atan2f((p.y - cy) / ry, (p.x - cx) / rx);
+  float rel = fmodf(theta - a0 + 4.0f * (float)M_PI, 2.0f * (float)M_PI);
+  vc_point on_arc;
+
+  if(rel > a1 - a0 + ARC_ANGLE_SLOP && rel < 2.0f * (float)M_PI - ARC_ANGLE_SLOP)
+    return INFINITY;
+  on_arc.x = cx + rx * cosf(theta);
+  on_arc.y = cy + ry * sinf(theta);
+  return point_dist(p, on_arc);
+}
+
+// tries to cover pts[i..j] with one arc segment.  On success fills in *the_arc and returns the worst error:
+static float try_arc(const vc_point *pts, int i, int j, float tolerance, vc_segment *the_arc){
+  vc_point p = pts[i], q = pts[j], mid = pts[(i + j) / 2];
+  float turn = (mid.x - p.x) * (q.y - mid.y) - (mid.y - p.y) * (q.x - mid.x);
+  float best = INFINITY;
+  int k0, span, k;
+
+  if(fabsf(turn) < 1e-3f)
+    return INFINITY;    // straight; a line does better
+  if(turn < 0.0f){
+    // arcs run counter-clockwise, so walk a clockwise curve from the other end:
+    vc_point tmp = p;
+    p = q;
+    q = tmp;
+  }
+
+  for(k0 = 0; k0 < 8; k0++){
+    for(span = 1; span < 8; span++){
+      float a0 = k0 * (float)M_PI / 4.0f;
+      float a1 = (k0 + span) * (float)M_PI / 4.0f;
+      float dc = cosf(a1) - cosf(a0);
+      float ds = sinf(a1) - sinf(a0);
+      float rx, ry, cx, cy, worst;
+      int x_size, y_size, x_offset, y_offset;
+      vc_point end;
+
+      if(fabsf(dc) < 0.01f || fabsf(ds) < 0.01f)
+        continue;       // that span leaves one radius undetermined
+      rx = (q.x - p.x) / dc;
+      ry = (q.y - p.y) / ds;
+      if(rx < 0.5f || ry < 0.5f)
+        continue;
+
+      // round to what the segment can actually hold, then measure against that:
+      x_size = lroundf(2.0f * rx);
+      y_size = lroundf(2.0f * ry);
+      x_offset = lroundf(p.x - rx * cosf(a0));
+      y_offset = lroundf(p.y - ry * sinf(a0));
+      if(x_size > 255 || y_size > 255 || x_offset < 0 || x_offset > 254 || y_offset < 0 || y_offset > 255)
+        continue;
+      rx = x_size / 2.0f;
+      ry = y_size / 2.0f;
+      cx = x_offset;
+      cy = y_offset;
+
+      end.x = cx + rx * cosf(a0);
+      end.y = cy + ry * sinf(a0);
+      worst = point_dist(p, end);
+      end.x = cx + rx * cosf(a1);
+      end.y = cy + ry * sinf(a1);
+      if(point_dist(q, end) > worst)
+        worst = point_dist(q, end);
+
+      // check the points and the midpoints of the edges between them:
+      for(k = i; k < j && worst <= tolerance; k++){
+        vc_point half = {(pts[k].x + pts[k + 1].x) / 2.0f, (pts[k].y + pts[k + 1].y) / 2.0f};
+        float d = arc_dist(pts[k], cx, cy, rx, ry, a0, a1);
+        float d2 = arc_dist(half, cx, cy, rx, ry, a0, a1);
+
+        if(d2 > d)
+          d = d2;
+        if(d > worst)
+          worst = d;
+      }
+
+      if(worst <= tolerance && worst < best){
+        vc_segment candidate = {x_offset, y_offset, x_size, y_size, cir, 0};
+        int b;
+
+        for(b = k0; b < k0 + span; b++)
+          candidate.mask |= 1 << ((5 - b) & 7);
+        *the_arc = candidate;
+        best = worst;
+      }
+    }
+  }
+  return best;
+}
+
+// the octant bit of the point at angle theta on an ellipse, in the order vc_segment masks use:
+static uint8 octant_bit(float theta){
+  int k = (int)floorf(theta / ((float)M_PI / 4.0f));
+
+  return 1 << ((5 - (k & 7)) & 7);
+}
+
+// Fits one axis-aligned ellipse to pts[i..j] by least squares.  With the points moved so their mean is at the
+// origin (which is always inside the ellipse, so the constant term can be taken as -1), the ellipse is
+//     A u^2 + C v^2 + D u + E v = 1
+// and the four coefficients come from the normal equations.  Succeeds, filling in *the_arc with the octants the
+// points pass through lit, only if the ellipse, rounded to what a segment can hold, is within tolerance of them all:
+static int fit_ellipse(const vc_point *pts, int i, int j, float tolerance, vc_segment *the_arc){
+  double m[4][5] = {{0}}, mx = 0, my = 0, u0, v0, g, coef[4];
+  float rx, ry, cx, cy;
+  int x_size, y_size, x_offset, y_offset, k, r, c;
+  uint8 mask = 0;
+
+  if(j - i < 4)
+    return 0;
+  for(k = i; k <= j; k++){
+    mx += pts[k].x;
+    my += pts[k].y;
+  }
+  mx /= j - i + 1;
+  my /= j - i + 1;
+  for(k = i; k <= j; k++){
+    double u = pts[k].x - mx, v = pts[k].y - my;
+    double row[4] = {u * u, v * v, u, v};
+
+    for(r = 0; r < 4; r++){
+      for(c = 0; c < 4; c++)
+        m[r][c] += row[r] * row[c];
+      m[r][4] += row[r];
+    }
+  }
+  // Gaussian elimination with partial pivoting:
+  for(c = 0; c < 4; c++){
+    int pivot = c;
+
+    for(r = c + 1; r < 4; r++)
+      if(fabs(m[r][c]) > fabs(m[pivot][c]))
+        pivot = r;
+    if(fabs(m[pivot][c]) < 1e-12)
+      return 0;
+    for(k = 0; k < 5; k++){
+      double tmp = m[c][k];
+      m[c][k] = m[pivot][k];
+      m[pivot][k] = tmp;
+    }
+    for(r = 0; r < 4; r++){
+      double f = m[r][c] / m[c][c];
+
+      if(r == c) continue;
+      for(k = c; k < 5; k++)
+        m[r][k] -= f * m[c][k];
+    }
+  }
+  for(r = 0; r < 4; r++)
+    coef[r] = m[r][4] / m[r][r];
+  if(coef[0] <= 0 || coef[1] <= 0)
+    return 0;     // not an ellipse
+  u0 = -coef[2] / (2 * coef[0]);
+  v0 = -coef[3] / (2 * coef[1]);
+  g = 1 + coef[0] * u0 * u0 + coef[1] * v0 * v0;
+
+  x_size = lround(2 * sqrt(g / coef[0]));
+  y_size = lround(2 * sqrt(g / coef[1]));
+  x_offset = lround(mx + u0);
+  y_offset = lround(my + v0);
+  if(x_size < 1 || y_size < 1 || x_size > 255 || y_size > 255 || x_offset < 0 || x_offset > 254 || y_offset < 0 ||
+     y_offset > 255)
+    return 0;
+  rx = x_size / 2.0f;
+  ry = y_size / 2.0f;
+  cx = x_offset;
+  cy = y_offset;
+
+  for(k = i; k <= j; k++){
+    if(arc_dist(pts[k], cx, cy, rx, ry, 0.0f, 2.0f * (float)M_PI) > tolerance)
+      return 0;
+    if(k < j){
+      vc_point half = {(pts[k].x + pts[k + 1].x) / 2.0f, (pts[k].y + pts[k + 1].y) / 2.0f};
+      float theta = atan2f((half.y - cy) / ry, (half.x - cx) / rx);
+
+      if(arc_dist(half, cx, cy, rx, ry, 0.0f, 2.0f * (float)M_PI) > tolerance)
+        return 0;
+      mask |= octant_bit(theta < 0.0f ? theta + 2.0f * (float)M_PI : theta);
+    }
+  }
+  the_arc->x_offset = x_offset;
+  the_arc->y_offset = y_offset;
+  the_arc->x_size = x_size;
+  the_arc->y_size = y_size;
+  the_arc->arc_type = cir;
+  the_arc->mask = mask;
+  return 1;
+}
+
+// sends a finished arc through the clip window, as arc() would, and returns the number of segments that made it:
+static int emit_arc(const vc_segment *the_arc, int which_buffer){
+  display_list *dl = &display_lists[which_buffer];
+  int before = dl->length;
+
+  ellipse_fx(the_arc->x_offset * VC_ONE, the_arc->y_offset * VC_ONE, the_arc->x_size * VC_ONE, the_arc->y_size * VC_ONE,
+             the_arc->mask, which_buffer);
+  return dl->length - before;
+}
+
+int fit_polyline(const vc_point *pts, int n, float tolerance, int which_buffer){
+  display_list *dl = &display_lists[which_buffer];
+  int i = 0, emitted = 0, have_arc = 0, arc_start = 0;
+  vc_segment pending;     // the last arc, held back while later runs might still join it
+
+  while(i < n - 1){
+    int line_end = i + 1, arc_end = -1, j;
+    vc_segment the_arc, candidate;
+
+    while(line_end + 1 < n && line_fits(pts, i, line_end + 1, tolerance))
+      line_end++;
+
+    for(j = i + 2; j < n && j <= i + ARC_MAX_POINTS; j++){
+      if(j > line_end && try_arc(pts, i, j, tolerance, &candidate) <= tolerance){
+        arc_end = j;
+        the_arc = candidate;
+      }
+    }
+
+    j = arc_end > line_end ? arc_end : line_end;
+    if(have_arc && fit_ellipse(pts, arc_start, j, tolerance, &candidate)){
+      // continues around the previous arc's ellipse (a half circle can't be fit in one go), so that grows instead:
+      pending = candidate;
+      i = j;
+    }
+    else if(arc_end > line_end && have_arc && pending.x_offset == the_arc.x_offset &&
+            pending.y_offset == the_arc.y_offset && pending.x_size == the_arc.x_size && pending.y_size == the_arc.y_size){
+      // too few points to fit, but the same ellipse anyway, so just light more octants:
+      pending.mask |= the_arc.mask;
+      i = arc_end;
+    }
+    else{
+      if(have_arc)
+        emitted += emit_arc(&pending, which_buffer);
+      have_arc = 0;
+      if(arc_end > line_end){
+        pending = the_arc;
+        have_arc = 1;
+        arc_start = i;
+        i = arc_end;
+      }
+      else{
+        int before = dl->length;
+
+        line_fx(lroundf(pts[i].x * VC_ONE), lroundf(pts[i].y * VC_ONE), lroundf(pts[line_end].x * VC_ONE), lroundf(pts[line_end].y * VC_ONE), which_buffer);
+        emitted += dl->length - before;   // none if it was clipped away
+        i = line_end;
+      }
+    }
+  }
+  if(have_arc)
+    emitted += emit_arc(&pending, which_buffer);
+  return emitted;
+}
+
+int bezier_points(vc_point p0, vc_point p1, vc_point p2, vc_point p3, float tolerance, vc_point *pts){
+  // the control polygon bounds the curve's length, which sets how finely to sample it:
+  float length = point_dist(p0, p1) + point_dist(p1, p2) + point_dist(p2, p3);
+  int steps = ceilf(2.0f * sqrtf(length / (tolerance > 0.1f ? tolerance : 0.1f)));
+  int k;
+
+  if(steps < BEZIER_MIN_STEPS)
+    steps = BEZIER_MIN_STEPS;
+  if(steps > BEZIER_MAX_POINTS - 1)
+    steps = BEZIER_MAX_POINTS - 1;
+
+  for(k = 0; k <= steps; k++){
+    float t = (float)k / steps, u = 1.0f - t;
+    float b0 = u * u * u, b1 = 3 * u * u * t, b2 = 3 * u * t * t, b3 = t * t * t;
+
+    pts[k].x = b0 * p0.x + b1 * p1.x + b2 * p2.x + b3 * p3.x;
+    pts[k].y = b0 * p0.y + b1 * p1.y + b2 * p2.y + b3 * p3.y;
+  }
+  return steps + 1;
+}
+
+int fit_bezier(vc_point p0, vc_point p1, vc_point p2, vc_point p3, float tolerance, int which_buffer){
+  vc_point pts[BEZIER_MAX_POINTS];
+
+  return fit_polyline(pts, bezier_points(p0, p1, p2, p3, tolerance, pts), tolerance, which_buffer);
+}
@@ -0,0 +1,38 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Fits polylines and Bezier curves with as few segments as possible, using octant-masked ellipse arcs
+ wherever they stay within tolerance and straight lines everywhere else.
+*/
+
+#ifndef curve_fit_h
+#define curve_fit_h
+
+#include "draw.h"
+
+typedef struct {
+  float x, y;
+} vc_point;
+
+// each returns the number of segments appended to which_buffer.  tolerance is the largest distance, in pixels,
+// the drawn segments may stray from the curve:
+int fit_polyline(const vc_point *pts, int n, float tolerance, int which_buffer);
+int fit_bezier(vc_point p0, vc_point p1, vc_point p2, vc_point p3, float tolerance, int which_buffer);
+
+// samples a cubic Bezier finely enough for the given tolerance, into pts (which must hold BEZIER_MAX_POINTS),
+// and returns the number of points:
+#define BEZIER_MAX_POINTS 65
+int bezier_points(vc_point p0, vc_point p1, vc_point p2, vc_point p3, float tolerance, vc_point *pts);
+
+#endif
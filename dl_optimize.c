@@ -0,0 +1,363 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Optimizer pass for finished display lists.  Every segment costs rpmsg bandwidth and refresh time on the bare
+ metal side, so before a list is sent we:
+   - drop segments that draw nothing (zero size, or a mask that blanks every octant)
+   - drop exact duplicates
+   - merge horizontal and vertical lines that overlap or touch end to end into a single line
+ The surviving segments keep their original order.
+
+ reorder_display_list() is a separate, optional stage that changes the drawing order to cut down on beam travel.
+*/
+
+#include <stdlib.h>
+#include "dl_optimize.h"
+
+dl_opt_stats last_opt_stats;
+dl_opt_stats total_opt_stats;
+
+#define REMOVED(seg) ((seg).flag = 0xff)    // marks a segment for removal by the final compaction
+
+static int is_line(vc_segment *seg){
+  return seg->arc_type == legacy_pos || seg->arc_type == legacy_neg || seg->arc_type == pos || seg->arc_type == neg;
+}
+
+// line() encodes a line as its midpoint (rounded down) and its extent, so the low end is offset - size/2:
+static int line_start(uint8 offset, uint8 size){
+  return offset - size/2;
+}
+
+/* ************* Duplicates ************* */
+
+// open-addressed hash set of segment indices, sized for MAX_BUF_ENTRIES:
+#define HASH_SLOTS 8192
+static int hash_slots[HASH_SLOTS];
+
+static unsigned int hash_segment(vc_segment *seg){
+  unsigned char *bytes = (unsigned char *)seg;
+  unsigned int h = 2166136261u;
+  size_t i;
+
+  for(i=0;i<sizeof(vc_segment);i++) h = (h ^ bytes[i]) * 16777619u;
+  return h;
+}
+
+static int remove_duplicates(seg_or_flag *segs, int n){
+  unsigned int slot;
+  int i, removed = 0;
+
+  for(i=0;i<HASH_SLOTS;i++) hash_slots[i] = -1;
+  for(i=0;i<n;i++){
+    if(segs[i].flag == 0xff) continue;
+    for(slot = hash_segment(&segs[i].seg_data) % HASH_SLOTS; hash_slots[slot] >= 0; slot = (slot + 1) % HASH_SLOTS){
+      if(memcmp(&segs[hash_slots[slot]],&segs[i],sizeof(vc_segment)) == 0) break;
+    }
+    if(hash_slots[slot] >= 0){
+      REMOVED(segs[i]);
+      removed++;
+    }
+    else hash_slots[slot] = i;
+  }
+  return removed;
+}
+
+/* ************* Collinear lines ************* */
+
+// An axis-aligned line, described so that lines on the same row or column sort next to each other:
+typedef struct {
+  int vertical;
+  int across;       // the y of a horizontal line, or the x of a vertical one
+  int arc_type;
+  int mask;
+  int start, end;   // extent along the line
+  int index;        // where it is in the display list
+} axis_line;
+
+static axis_line axis_lines[MAX_BUF_ENTRIES];
+
+static int compare_axis_lines(const void *a, const void *b){
+  const axis_line *l0 = a, *l1 = b;
+  if(l0->vertical != l1->vertical) return l0->vertical - l1->vertical;
+  if(l0->across != l1->across) return l0->across - l1->across;
+  if(l0->arc_type != l1->arc_type) return l0->arc_type - l1->arc_type;
+  if(l0->mask != l1->mask) return l0->mask - l1->mask;
+  if(l0->start != l1->start) return l0->start - l1->start;
+  return l0->index - l1->index;
+}
+
+static void encode_axis_line(vc_segment *seg, axis_line *l){
+  if(l->vertical){
+    seg->y_offset = (l->start + l->end) / 2;
+    seg->y_size = l->end - l->start;
+  }
+  else{
+    seg->x_offset = (l->start + l->end) / 2;
+    seg->x_size = l->end - l->start;
+  }
+}
+
+static int merge_lines(seg_or_flag *segs, int n){
+  vc_segment *seg;
+  axis_line *run, *l;
+  int n_lines = 0, merged = 0, i;
+
+  for(i=0;i<n;i++){
+    seg = &segs[i].seg_data;
+    if(segs[i].flag == 0xff || !is_line(seg) || (seg->x_size != 0 && seg->y_size != 0)) continue;
+    l = &axis_lines[n_lines++];
+    l->vertical = (seg->x_size == 0);
+    l->across = l->vertical ? seg->x_offset : seg->y_offset;
+    l->arc_type = seg->arc_type;
+    l->mask = seg->mask;
+    l->start = l->vertical ? line_start(seg->y_offset,seg->y_size) : line_start(seg->x_offset,seg->x_size);
+    l->end = l->start + (l->vertical ? seg->y_size : seg->x_size);
+    l->index = i;
+  }
+  qsort(axis_lines,n_lines,sizeof(axis_line),compare_axis_lines);
+
+  // sweep each row/column, folding every line that overlaps or touches the current run into it:
+  for(run = axis_lines, l = axis_lines + 1; l <= axis_lines + n_lines; l++){
+    if(l < axis_lines + n_lines && l->vertical == run->vertical && l->across == run->across && l->arc_type == run->arc_type &&
+       l->mask == run->mask && l->start <= run->end + 1 && (l->end > run->end ? l->end : run->end) - run->start <= 255){
+      if(l->end > run->end) run->end = l->end;
+      if(l->index < run->index){   // keep the merged line where the earliest piece was
+        REMOVED(segs[run->index]);
+        run->index = l->index;
+      }
+      else REMOVED(segs[l->index]);
+      merged++;
+      continue;
+    }
+    encode_axis_line(&segs[run->index].seg_data,run);
+    run = l;
+  }
+  return merged;
+}
+
+/* ************* The pass itself ************* */
+
+static int new_index[MAX_BUF_ENTRIES + 1];
+
+void optimize_display_list(display_list *dl){
+  seg_or_flag *segs = dl->segs;
+  vc_segment *seg;
+  int n = dl->length;
+  int i, j;
+
+  last_opt_stats.segs_in = n;
+  last_opt_stats.dropped = 0;
+
+  for(i=0;i<n;i++){
+    seg = &segs[i].seg_data;
+    if(seg->mask == 0 || (seg->x_size == 0 && seg->y_size == 0)){
+      REMOVED(segs[i]);
+      last_opt_stats.dropped++;
+    }
+  }
+  last_opt_stats.duplicates = remove_duplicates(segs,n);
+  last_opt_stats.merged = merge_lines(segs,n);
+
+  for(i=0,j=0;i<n;i++){
+    new_index[i] = j;
+    if(segs[i].flag != 0xff) segs[j++] = segs[i];
+  }
+  new_index[n] = j;
+  for(i=0;i<dl->n_fixed;i++){   // the fixed-order ranges move with their segments
+    dl->fixed_start[i] = new_index[dl->fixed_start[i]];
+    dl->fixed_end[i] = new_index[dl->fixed_end[i]];
+  }
+  dl->length = j;
+  segs[j].flag = 0xff;
+  segs[j].seg_data.mask = 0;
+  last_opt_stats.segs_out = j;
+
+  total_opt_stats.segs_in += last_opt_stats.segs_in;
+  total_opt_stats.segs_out += last_opt_stats.segs_out;
+  total_opt_stats.dropped += last_opt_stats.dropped;
+  total_opt_stats.duplicates += last_opt_stats.duplicates;
+  total_opt_stats.merged += last_opt_stats.merged;
+}
+
+/* ************* Beam travel ************* */
+
+// The remote draws the list over and over, so the beam travels from the end of each segment to the start of the
+// next, and from the last back to the first.  We treat each free segment, and each fixed-order range as a whole,
+// as a "unit" with an entry and an exit point, and reorder the units to shorten that blanked travel:
+// nearest neighbor first, then 2-opt.  Lines are entered at their left end and left at their right end (line()
+// always draws left to right); closed shapes are approximated by their center.  Both deflection axes slew at
+// once, so the cost of a move is the larger of |dx| and |dy|.
+
+reorder_stats last_reorder_stats;
+
+#define REORDER_MAX_UNITS 1024    // nearest neighbor is O(n^2), so bigger lists are left as they are
+#define TWO_OPT_MAX_UNITS 400     // and 2-opt is O(n^2) per pass
+#define TWO_OPT_MAX_PASSES 4
+
+typedef struct {
+  int first, last;          // segment indices, inclusive
+  int entry_x, entry_y;
+  int exit_x, exit_y;
+} travel_unit;
+
+static travel_unit units[MAX_BUF_ENTRIES];
+static int tour[MAX_BUF_ENTRIES];
+static int fwd_sum[MAX_BUF_ENTRIES + 1], bwd_sum[MAX_BUF_ENTRIES + 1];
+static seg_or_flag reordered[MAX_BUF_ENTRIES];
+
+static void segment_ends(vc_segment *seg, int *entry_x, int *entry_y, int *exit_x, int *exit_y){
+  int x0, y0;
+
+  if(!is_line(seg)){
+    *entry_x = *exit_x = seg->x_offset;
+    *entry_y = *exit_y = seg->y_offset;
+    return;
+  }
+  x0 = line_start(seg->x_offset,seg->x_size);
+  y0 = line_start(seg->y_offset,seg->y_size);
+  *entry_x = x0;
+  *exit_x = x0 + seg->x_size;
+  if(seg->arc_type == legacy_neg || seg->arc_type == neg){   // falling line
+    *entry_y = y0 + seg->y_size;
+    *exit_y = y0;
+  }
+  else{
+    *entry_y = y0;
+    *exit_y = y0 + seg->y_size;
+  }
+}
+
+// blanked travel from the exit of unit a to the entry of unit b:
+static int hop(int a, int b){
+  int dx = abs(units[a].exit_x - units[b].entry_x);
+  int dy = abs(units[a].exit_y - units[b].entry_y);
+  return dx > dy ? dx : dy;
+}
+
+static int tour_length(int n){
+  int i, length = 0;
+  for(i=0;i<n;i++) length += hop(tour[i],tour[(i+1) % n]);
+  return length;
+}
+
+// splits the list into units.  Returns the number of units:
+static int build_units(display_list *dl){
+  int n_units = 0, i, range, x, y;
+  travel_unit *u;
+
+  for(i=0;i<dl->length;){
+    u = &units[n_units++];
+    u->first = u->last = i;
+    for(range=0;range<dl->n_fixed;range++){
+      if(dl->fixed_start[range] == i && dl->fixed_end[range] > i) u->last = dl->fixed_end[range] - 1;
+    }
+    segment_ends(&dl->segs[u->first].seg_data,&u->entry_x,&u->entry_y,&x,&y);
+    segment_ends(&dl->segs[u->last].seg_data,&x,&y,&u->exit_x,&u->exit_y);
+    i = u->last + 1;
+  }
+  return n_units;
+}
+
+static void nearest_neighbor_tour(int n){
+  static char visited[MAX_BUF_ENTRIES];
+  int i, j, best, best_cost, cost;
+
+  memset(visited,0,n);
+  tour[0] = 0;    // the first unit stays first
+  visited[0] = 1;
+  for(i=1;i<n;i++){
+    best = -1;
+    best_cost = 0;
+    for(j=1;j<n;j++){
+      if(visited[j]) continue;
+      cost = hop(tour[i-1],j);
+      if(best < 0 || cost < best_cost){
+        best = j;
+        best_cost = cost;
+      }
+    }
+    tour[i] = best;
+    visited[best] = 1;
+  }
+}
+
+// Reversing tour[i..j] changes which way each hop inside the span is taken, and hops are not symmetric, so we
+// keep prefix sums of the forward and backward hops to price a reversal in O(1):
+static void sum_hops(int n){
+  int k;
+  fwd_sum[0] = bwd_sum[0] = 0;
+  for(k=0;k<n-1;k++){
+    fwd_sum[k+1] = fwd_sum[k] + hop(tour[k],tour[k+1]);
+    bwd_sum[k+1] = bwd_sum[k] + hop(tour[k+1],tour[k]);
+  }
+}
+
+static void two_opt(int n){
+  int pass, i, j, a, b, delta, improved, tmp;
+
+  for(pass=0;pass<TWO_OPT_MAX_PASSES;pass++){
+    improved = 0;
+    sum_hops(n);
+    for(i=1;i<n-1;i++){
+      for(j=i+1;j<n;j++){
+        a = tour[i-1];
+        b = tour[(j+1) % n];
+        delta = hop(a,tour[j]) + hop(tour[i],b) + (bwd_sum[j] - bwd_sum[i])
+              - hop(a,tour[i]) - hop(tour[j],b) - (fwd_sum[j] - fwd_sum[i]);
+        if(delta < 0){
+          for(a=i,b=j;a<b;a++,b--){
+            tmp = tour[a];
+            tour[a] = tour[b];
+            tour[b] = tmp;
+          }
+          sum_hops(n);
+          improved = 1;
+        }
+      }
+    }
+    if(!improved) break;
+  }
+}
+
+void reorder_display_list(display_list *dl){
+  int n_units = build_units(dl);
+  int i, k, n;
+
+  for(i=0;i<n_units;i++) tour[i] = i;
+  last_reorder_stats.travel_before = tour_length(n_units);
+  last_reorder_stats.travel_after = last_reorder_stats.travel_before;
+  if(n_units < 3 || n_units > REORDER_MAX_UNITS) return;
+
+  nearest_neighbor_tour(n_units);
+  if(n_units <= TWO_OPT_MAX_UNITS) two_opt(n_units);
+  last_reorder_stats.travel_after = tour_length(n_units);
+  if(last_reorder_stats.travel_after >= last_reorder_stats.travel_before){   // no better than what we had
+    last_reorder_stats.travel_after = last_reorder_stats.travel_before;
+    return;
+  }
+
+  // rebuild the list in tour order, moving the fixed ranges along with their segments:
+  for(i=0,n=0;i<n_units;i++){
+    travel_unit *u = &units[tour[i]];
+    for(k=0;k<dl->n_fixed;k++){
+      if(dl->fixed_start[k] == u->first && dl->fixed_end[k] > u->first){
+        dl->fixed_end[k] = n + dl->fixed_end[k] - dl->fixed_start[k];
+        dl->fixed_start[k] = n;
+        break;
+      }
+    }
+    for(k=u->first;k<=u->last;k++) reordered[n++] = dl->segs[k];
+  }
+  memcpy(dl->segs,reordered,n * sizeof(seg_or_flag));
+}
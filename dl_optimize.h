@@ -0,0 +1,44 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Optimizer pass for finished display lists, run just before they're sent to the remote
+*/
+
+#ifndef dl_optimize_h
+#define dl_optimize_h
+
+#include "draw.h"
+
+typedef struct {
+  int segs_in;      // segments before optimizing
+  int segs_out;     // and after
+  int dropped;      // zero-size or fully blanked segments
+  int duplicates;   // exact copies of an earlier segment
+  int merged;       // line segments folded into a collinear neighbor
+} dl_opt_stats;
+
+extern dl_opt_stats last_opt_stats;     // from the most recent call
+extern dl_opt_stats total_opt_stats;    // running totals
+
+typedef struct {
+  int travel_before;    // estimated blanked beam travel per refresh, in pixels, before reordering
+  int travel_after;     // and after
+} reorder_stats;
+
+extern reorder_stats last_reorder_stats;
+
+void optimize_display_list(display_list *dl);
+void reorder_display_list(display_list *dl);
+
+#endif
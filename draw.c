@@ -15,54 +15,353 @@
  Routines to compile strings, menus, and other primitives into display lists
 
  *******************************************************************************/
+#include <stdlib.h>
+#include <math.h>
 #include "draw.h"
-seg_or_flag seg_buffer[3][BUF_ENTRIES];
+#include "seg_kernels.h"
+
+display_list display_lists[N_BUFFERS];
+
+// makes sure there's room for n segments plus the sentinel.  Returns 0 if that would exceed MAX_BUF_ENTRIES:
+static int dl_reserve(display_list *dl, int n){
+  int new_capacity = dl->capacity ? dl->capacity : BUF_ENTRIES;
+  seg_or_flag *new_segs;
+
+  if(n + 1 <= dl->capacity) return 1;
+  if(n + 1 > MAX_BUF_ENTRIES) return 0;
+  while(new_capacity < n + 1) new_capacity *= 2;
+  if(new_capacity > MAX_BUF_ENTRIES) new_capacity = MAX_BUF_ENTRIES;
+
+  new_segs = realloc(dl->segs, new_capacity * sizeof(seg_or_flag));
+  if(new_segs == NULL) return 0;
+  dl->segs = new_segs;
+  dl->capacity = new_capacity;
+  dl->grows++;
+  return 1;
+}
+
+// writes the terminating flag just past the last segment:
+static void dl_terminate(display_list *dl){
+  seg_or_flag *sentinel = dl->segs + dl->length;
+  sentinel->seg_data.x_offset = 0xff;
+  sentinel->seg_data.mask = 0;
+}
+
+void dl_clear(display_list *dl){
+  dl->length = 0;
+  dl->n_fixed = 0;
+  dl->text_length = 0;
+  if(!dl_reserve(dl,0)) return;
+  dl_terminate(dl);
+}
+
+// appends one segment.  Returns 1 on success, or 0 if the list is full.
+// An x_offset of 0xff would read as the end of the list, so such segments (usually pinned off the right edge) are dropped:
+int dl_append(display_list *dl, vc_segment *seg){
+  if(seg->x_offset == 0xff) return 1;
+  if(!dl_reserve(dl,dl->length + 1)){
+    dl->overflows++;
+    return 0;
+  }
+  dl->segs[dl->length++].seg_data = *seg;
+  if(dl->length > dl->high_water) dl->high_water = dl->length;
+  dl_terminate(dl);
+  return 1;
+}
+
+// appends a run of segments as one block and returns a pointer to the copies, so the caller can transform them
+// in place.  Returns NULL (and appends nothing) if the run doesn't fit.  Call dl_drop_flags() when done:
+static vc_segment *dl_extend(display_list *dl, const vc_segment *run, int n){
+  vc_segment *copies;
+
+  if(!dl_reserve(dl,dl->length + n)) return NULL;
+  copies = &dl->segs[dl->length].seg_data;
+  memcpy(copies,run,n * sizeof(vc_segment));
+  dl->length += n;
+  if(dl->length > dl->high_water) dl->high_water = dl->length;
+  dl_terminate(dl);
+  return copies;
+}
+
+// removes any segments from index first on whose x_offset became 0xff, as dl_append would have:
+static void dl_drop_flags(display_list *dl, int first){
+  seg_or_flag *src = dl->segs + first;
+  seg_or_flag *dst = src;
+  seg_or_flag *end = dl->segs + dl->length;
+
+  while(src < end && src->flag != 0xff) src++;
+  if(src == end) return;      // the usual case
+  for(dst = src; src < end; src++){
+    if(src->flag != 0xff) *dst++ = *src;
+  }
+  dl->length = dst - dl->segs;
+  dl_terminate(dl);
+}
+
+// segments appended between these two calls will be drawn in the order they were appended, even if the list is
+// reordered.  If a list runs out of ranges, the last one is stretched to cover the new one:
+void dl_begin_fixed_order(display_list *dl){
+  if(dl->n_fixed < MAX_FIXED_RANGES) dl->fixed_start[dl->n_fixed++] = dl->length;
+  dl->fixed_end[dl->n_fixed-1] = dl->length;
+}
+
+void dl_end_fixed_order(display_list *dl){
+  if(dl->n_fixed) dl->fixed_end[dl->n_fixed-1] = dl->length;
+}
+
+// size in bytes of the display list, including the sentinel:
+int dl_size(display_list *dl){
+  return (dl->length + 1) * sizeof(seg_or_flag);
+}
+
+// the segments and sentinel, for sending.  A list that couldn't be allocated reads as an empty one:
+const seg_or_flag *dl_segs(display_list *dl){
+  static const seg_or_flag empty[] = {SEG_END};
+  return dl->segs ? dl->segs : empty;
+}
 
 void clear_buffer(int which_buffer){
-  seg_buffer[which_buffer][0].flag = 0xff;    // set terminating flag in first buffer entry]
+  dl_clear(&display_lists[which_buffer]);
 }
 
-// turns a string into a display  buffer:
-// if append !=0, it appends to the buffer
-// otherwise it overwrites:
+// Glyph cache: each (character, scale) pair is scaled and pinned once, relative to the character's origin,
+// so compileString only has to add the origin to each segment.  pin(scale*offset + origin) equals
+// pin(pin(scale*offset) + origin) since neither term is negative, so the output is unchanged:
+#define GLYPH_CACHE_SCALES 8    // scales 1..8 are cached, anything else is compiled directly
+
+typedef struct {
+  vc_segment *segs;   // NULL until the glyph is first used at this scale
+  int n_segs;
+  int advance;        // scale * char width
+} cached_glyph;
+
+static cached_glyph glyph_cache[128][GLYPH_CACHE_SCALES];
+unsigned long glyph_cache_hits = 0;
+unsigned long glyph_cache_misses = 0;
+
+// returns the cached copy of a system font glyph at this scale, building it on first use.  Returns NULL if it
+// can't be cached.  Loaded fonts are used in place, so their glyphs aren't cached:
+static cached_glyph *get_glyph(glyph_ref *src, uint8 scale){
+  cached_glyph *glyph;
+  int i;
+
+  if(current_font() != &system_font || scale < 1 || scale > GLYPH_CACHE_SCALES) return NULL;
+  glyph = &glyph_cache[src->id][scale-1];
+  if(glyph->segs){
+    glyph_cache_hits++;
+    return glyph;
+  }
 
-void compileString(char *s, uint8 x_coord, uint8 y_coord,uint8 buffer_index,uint8 scale,int append){
-  seg_or_flag *src_ptr;
-  seg_or_flag *dst_ptr;
-  uint8 x;
-  int num_segs=0;     // so we don't overrun our fixed-size buffer
-
-  int kerning = (scale <= 2 || scale > 3) ? 4: 3;
-  if(scale==5) kerning+=1;
-  if(strlen(s)<6) kerning += 2;
-  int string_width = stringWidth(s,scale) + (strlen(s)-1)*kerning;
+  glyph_cache_misses++;
+  glyph->segs = malloc((src->n_segs ? src->n_segs : 1) * sizeof(vc_segment));
+  if(glyph->segs == NULL) return NULL;
+  for(i=0;i<src->n_segs;i++) glyph->segs[i] = src->segs[i].seg_data;
+  seg_scale(glyph->segs,src->n_segs,scale);
+  glyph->n_segs = src->n_segs;
+  glyph->advance = scale*src->width;
+  return glyph;
+}
+
+// appends a glyph's segments at the given origin.  Returns 0 if the buffer filled up:
+static int append_glyph(display_list *dl, cached_glyph *glyph, uint8 x_coord, uint8 y_coord){
+  int first = dl->length;
+  vc_segment *copies = dl_extend(dl,glyph->segs,glyph->n_segs);
+  vc_segment seg;
+  int i;
+
+  if(copies){
+    seg_offset(copies,glyph->n_segs,x_coord,y_coord);
+    dl_drop_flags(dl,first);
+    return 1;
+  }
+
+  // no room for the whole glyph, so fill what's left one segment at a time:
+  for(i=0;i<glyph->n_segs;i++){
+    seg = glyph->segs[i];
+    seg.x_offset = pin(seg.x_offset + x_coord);
+    seg.y_offset = pin(seg.y_offset + y_coord);
+    if(!dl_append(dl,&seg)) return 0;
+  }
+  return 1;
+}
+
+// compiles the glyphs of the first len bytes of a UTF-8 string into dl, in the current font.  Returns 0 if the
+// buffer filled up:
+static int compile_glyphs(display_list *dl, const char *s, int len, uint8 x_coord, uint8 y_coord, uint8 scale, int kerning){
+  cached_glyph *glyph;
+  const seg_or_flag *src_ptr;
+  vc_segment seg;
+  const char *end = s + len;
+  glyph_ref src;
+  int n_segs;
+
+  int string_width = stringWidth(s,len,scale) + (utf8_length(s,len)-1)*kerning;
   if(x_coord==255){
     x_coord = pin(128 - (string_width / 2));    //center on 128 if x coord has magic value
   }
-  dst_ptr = seg_buffer[buffer_index];
-  while(append && dst_ptr->flag != 255){            // skip over existing entries;
-    dst_ptr++;
-    num_segs++;
-  }
-  while(*s && num_segs<BUF_ENTRIES){ 
-    num_segs++;
-    src_ptr = system_font[((uint8) *s)-32];
-    while(src_ptr->seg_data.x_offset<0x80){
-      dst_ptr->seg_data.x_offset = pin(scale*src_ptr->seg_data.x_offset+x_coord);
-      dst_ptr->seg_data.y_offset = pin(scale*src_ptr->seg_data.y_offset+y_coord);
-      dst_ptr->seg_data.x_size = pin(scale*src_ptr->seg_data.x_size);
-      dst_ptr->seg_data.y_size = pin(scale*src_ptr->seg_data.y_size);
-      dst_ptr->seg_data.arc_type = src_ptr->seg_data.arc_type;
-      dst_ptr->seg_data.mask = src_ptr->seg_data.mask;
+  while(s < end){ 
+    if(!font_glyph(current_font(),utf8_next(&s,end),&src)) continue;
+    glyph = get_glyph(&src,scale);
+    if(glyph){
+      if(!append_glyph(dl,glyph,x_coord,y_coord)) return 0;
+      x_coord = pin(x_coord + glyph->advance + kerning);
+      continue;
+    }
+
+    // uncacheable, so compile the glyph directly:
+    src_ptr = src.segs;
+    for(n_segs = src.n_segs; n_segs > 0; n_segs--){
+      seg.x_offset = pin(scale*src_ptr->seg_data.x_offset+x_coord);
+      seg.y_offset = pin(scale*src_ptr->seg_data.y_offset+y_coord);
+      seg.x_size = pin(scale*src_ptr->seg_data.x_size);
+      seg.y_size = pin(scale*src_ptr->seg_data.y_size);
+      seg.arc_type = src_ptr->seg_data.arc_type;
+      seg.mask = src_ptr->seg_data.mask;
+      if(!dl_append(dl,&seg)) return 0;
       src_ptr++;
-      dst_ptr++;
     }
 
-    x_coord = pin(x_coord + scale*char_width(*s) + kerning);
-    s++;
+    x_coord = pin(x_coord + scale*src.width + kerning);
+  }
+  return 1;
+}
+
+// String cache: most modes compile the same strings at the same place every frame, so the finished segments
+// for the last few (font, string, x, y, scale, kerning) combinations are kept, and reused least-recently-used first.
+// The x_coord in the key is the one passed in, so centered strings (x_coord==255) are cached as such:
+#define STRING_CACHE_ENTRIES 32
+#define STRING_CACHE_MAX_CHARS 63   // longer strings are always compiled
+
+typedef struct {
+  vc_font *font;
+  char text[STRING_CACHE_MAX_CHARS+1];
+  uint8 x_coord, y_coord, scale;
+  int kerning;
+  vc_segment *segs;
+  int n_segs;
+  int capacity;
+  unsigned long last_used;    // 0 for an empty entry
+} cached_string;
+
+static cached_string string_cache[STRING_CACHE_ENTRIES];
+static unsigned long string_cache_clock = 0;
+unsigned long string_cache_hits = 0;
+unsigned long string_cache_misses = 0;
+
+static cached_string *find_string(char *s, uint8 x_coord, uint8 y_coord, uint8 scale, int kerning){
+  cached_string *entry;
+
+  for(entry = string_cache; entry < string_cache + STRING_CACHE_ENTRIES; entry++){
+    if(entry->last_used && entry->font == current_font() && entry->x_coord == x_coord && entry->y_coord == y_coord && entry->scale == scale &&
+       entry->kerning == kerning && strcmp(entry->text,s) == 0){
+      entry->last_used = ++string_cache_clock;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+// saves a freshly compiled run, replacing the least recently used entry:
+static void cache_string(char *s, int len, uint8 x_coord, uint8 y_coord, uint8 scale, int kerning, seg_or_flag *run, int n_segs){
+  cached_string *entry, *victim = string_cache;
+  vc_segment *segs;
+  int i;
+
+  if(len > STRING_CACHE_MAX_CHARS) return;
+  for(entry = string_cache; entry < string_cache + STRING_CACHE_ENTRIES; entry++){
+    if(entry->last_used < victim->last_used) victim = entry;
+  }
+  if(n_segs > victim->capacity){
+    segs = realloc(victim->segs,n_segs * sizeof(vc_segment));
+    if(segs == NULL) return;
+    victim->segs = segs;
+    victim->capacity = n_segs;
+  }
+  for(i=0;i<n_segs;i++) victim->segs[i] = run[i].seg_data;
+  strcpy(victim->text,s);
+  victim->font = current_font();
+  victim->x_coord = x_coord;
+  victim->y_coord = y_coord;
+  victim->scale = scale;
+  victim->kerning = kerning;
+  victim->n_segs = n_segs;
+  victim->last_used = ++string_cache_clock;
+}
+
+// turns a string into a display  buffer:
+// if append !=0, it appends to the buffer
+// otherwise it overwrites:
+
+void compileString(char *s, uint8 x_coord, uint8 y_coord,uint8 buffer_index,uint8 scale,int append){
+  display_list *dl = &display_lists[buffer_index];
+  cached_string *entry;
+  int len = strlen(s);
+  int first;
+  int kerning = font_kerning(scale,utf8_length(s,len));
+
+  if(!append) dl_clear(dl);
+
+  entry = find_string(s,x_coord,y_coord,scale,kerning);
+  if(entry && dl_extend(dl,entry->segs,entry->n_segs)){
+    string_cache_hits++;
+    return;
+  }
+
+  string_cache_misses++;
+  first = dl->length;
+  if(compile_glyphs(dl,s,len,x_coord,y_coord,scale,kerning) && !entry){
+    cache_string(s,len,x_coord,y_coord,scale,kerning,dl->segs + first,dl->length - first);
   }
-  dst_ptr->seg_data.x_offset = 0xff;       //used as a flag, but width not used
-  dst_ptr->seg_data.mask=0;
+}
+
+int remote_text = 0;
+
+// makes sure the text records can grow to n bytes:
+static int dl_reserve_text(display_list *dl, int n){
+  int capacity = dl->text_capacity ? dl->text_capacity : 256;
+  uint8 *text;
+
+  if(n <= dl->text_capacity) return 1;
+  while(capacity < n) capacity *= 2;
+  text = realloc(dl->text, capacity);
+  if(text == NULL) return 0;
+  dl->text = text;
+  dl->text_capacity = capacity;
+  return 1;
+}
+
+void drawText(char *s, uint8 x_coord, uint8 y_coord, uint8 buffer_index, uint8 scale, int append){
+  display_list *dl = &display_lists[buffer_index];
+  int len = strlen(s), n_chars = utf8_length(s,len), n_glyphs = 0;
+  int kerning = font_kerning(scale,n_chars);
+  const char *p = s, *end = s + len;
+  glyph_ref glyph;
+  uint8 *record;
+
+  // the remote only has the system font, which it indexes the old way, by character code - 32:
+  if(!remote_text || current_font() != &system_font || n_chars > TEXT_RECORD_MAX_CHARS){
+    compileString(s,x_coord,y_coord,buffer_index,scale,append);
+    return;
+  }
+  if(!append) dl_clear(dl);
+  if(!dl_reserve_text(dl,dl->text_length + TEXT_RECORD_HEADER + n_chars)){
+    dl->overflows++;
+    return;
+  }
+
+  if(x_coord==255)
+    x_coord = pin(128 - ((stringWidth(s,len,scale) + (n_chars-1)*kerning) / 2));   // as compile_glyphs centers
+  record = dl->text + dl->text_length;
+  while(p < end){
+    if(font_glyph(&system_font,utf8_next(&p,end),&glyph))
+      record[TEXT_RECORD_HEADER + n_glyphs++] = glyph.id + 32;
+  }
+  record[0] = x_coord;
+  record[1] = y_coord;
+  record[2] = scale;
+  record[3] = kerning;
+  record[4] = n_glyphs;
+  dl->text_length += TEXT_RECORD_HEADER + n_glyphs;
 }
 
 void compile_substring(char *s, uint8 count,uint8 x_coord, uint8 y_coord,uint8 which_buffer,uint8 scale,uint8 append){
@@ -77,64 +376,108 @@ void compile_substring(char *s, uint8 count,uint8 x_coord, uint8 y_coord,uint8 w
 // if append !=0, it appends to the buffer.  Otherwise ir overwrites the buffer:
 
 void compileSegments(seg_or_flag *src_ptr, uint8 buffer_index,int append){
-  seg_or_flag *dst_ptr;
-  int num_segs=0;     // so we don't overrun our fixed-size buffer
+  display_list *dl = &display_lists[buffer_index];
 
-  dst_ptr = seg_buffer[buffer_index];
-  while(append && dst_ptr->flag != 255) {
-    dst_ptr++;
-    num_segs++;
-  }
-  while(src_ptr->seg_data.x_offset != 255 && num_segs<BUF_ENTRIES){
-    num_segs++;
-    dst_ptr->seg_data = src_ptr->seg_data;
+  if(!append) dl_clear(dl);
+  while(src_ptr->seg_data.x_offset != 255){
+    if(!dl_append(dl,&src_ptr->seg_data)) return;
     src_ptr++;
-    dst_ptr++;
   }
-  dst_ptr->flag = 0xff;       // sentinel value
-  dst_ptr->seg_data.mask=0;
 }
-void offsetSegments(seg_or_flag *src_ptr, uint8 x, uint8 y){
-  while(src_ptr->flag != 255){
-    src_ptr->seg_data.x_offset += x;
-    src_ptr->seg_data.y_offset += y;
-    src_ptr++;
-  }
+// offsets and insets modify a sentinel-terminated list in place, saturating rather than wrapping around:
+static int count_segments(seg_or_flag *src_ptr){
+  int n = 0;
+  while(src_ptr[n].flag != 255) n++;
+  return n;
+}
+
+void offsetSegments(seg_or_flag *src_ptr, int x, int y){
+  seg_offset(&src_ptr->seg_data,count_segments(src_ptr),x,y);
 }
 void insetSegments(seg_or_flag *src_ptr, uint8 x, uint8 y){
-    while(src_ptr->flag != 255){
-        src_ptr->seg_data.x_size -= x;
-        src_ptr->seg_data.y_size -= y;
-        src_ptr++;
-      }
+  seg_inset(&src_ptr->seg_data,count_segments(src_ptr),x,y);
+}
+// The primitives below work in 12.4 fixed point (vc_coord) and clip against the clip window, normally the visible
+// 0..255 square.  Only the finished segment is quantized to the 8-bit wire format, so nothing off-screen wraps
+// around to the other side.
+static int clip_left = 0, clip_bottom = 0, clip_right = VC_FX(255), clip_top = VC_FX(255);
+
+void set_clip_window(int x0, int y0, int x1, int y1){
+  clip_left = VC_FX(x0 < 0 ? 0 : x0);
+  clip_bottom = VC_FX(y0 < 0 ? 0 : y0);
+  clip_right = VC_FX(x1 > 255 ? 255 : x1);
+  clip_top = VC_FX(y1 > 255 ? 255 : y1);
+}
+void reset_clip_window(void){
+  set_clip_window(0, 0, 255, 255);
+}
+
+unsigned long segs_clipped;
+unsigned long segs_culled;
+
+// rounds a fixed point position to the nearest pixel.  Halves round down, as the old integer midpoints did, and
+// 255 is avoided because a segment starting with it reads as the end of the list:
+static uint8 quantize(int v){
+  v = (v + VC_ONE / 2 - 1) >> VC_FRAC_BITS;
+  if(v < 0) return 0;
+  if(v > 254) return 254;
+  return v;
+}
+static uint8 quantize_size(int v){
+  v = (v + VC_ONE / 2 - 1) >> VC_FRAC_BITS;
+  if(v < 0) return 0;
+  if(v > 255) return 255;
+  return v;
 }
-void circle(uint8 x0, uint8 y0, uint8 radius,int which_buffer){
-  seg_or_flag the_circle[] = {{0,0,0,0,cir,0xff},
-			      {.flag=0xff}};
-  the_circle->seg_data.x_offset = x0;
-  the_circle->seg_data.y_offset = y0;
 
-  the_circle->seg_data.x_size =  radius;
-  the_circle->seg_data.y_size = radius;
+// Liang-Barsky: trims the line from (*x0,*y0) to (*x1,*y1) to the clip square.  Returns 0 if none of it is visible.
+static int clip_line(int *x0, int *y0, int *x1, int *y1){
+  float dx = *x1 - *x0, dy = *y1 - *y0;
+  float p[4] = {-dx, dx, -dy, dy};
+  float q[4] = {*x0 - clip_left, clip_right - *x0, *y0 - clip_bottom, clip_top - *y0};
+  float t0 = 0.0f, t1 = 1.0f;
+  int i, sx = *x0, sy = *y0;
+
+  for(i = 0; i < 4; i++){
+    if(p[i] == 0.0f){
+      if(q[i] < 0.0f) return 0;   // parallel to this edge, and outside it
+    }
+    else{
+      float t = q[i] / p[i];
+
+      if(p[i] < 0.0f){
+        if(t > t1) return 0;
+        if(t > t0) t0 = t;
+      }
+      else{
+        if(t < t0) return 0;
+        if(t < t1) t1 = t;
+      }
+    }
+  }
 
-  compileSegments(the_circle,which_buffer, APPEND);
+  if(t0 > 0.0f || t1 < 1.0f){
+    *x0 = sx + lroundf(t0 * dx);
+    *y0 = sy + lroundf(t0 * dy);
+    *x1 = sx + lroundf(t1 * dx);
+    *y1 = sy + lroundf(t1 * dy);
+    segs_clipped++;
+  }
+  return 1;
 }
 
-// NOTE: line is temporarily using legacy pos/neg until I make a new analog board
-// Current analog filters make ends of sawtooth lines very slightly ragged/ 
+// rising is the arc_type for a line that climbs to the right (legacy_pos or pos); falling lines get its partner:
+static void emit_line(int x0, int y0, int x1, int y1, shape rising, uint8 mask, int which_buffer){
+  vc_segment the_line = {0,0,0,0,rising,mask};
+
+  if(!clip_line(&x0, &y0, &x1, &y1)){
+    segs_culled++;
+    return;
+  }
 
-void line(uint8 x0, uint8 y0, uint8 x1, uint8 y1,int which_buffer){
-#define OLD_STYLE_LINES
-#ifdef OLD_STYLE_LINES
-  seg_or_flag the_line[] = {{0,0,0,0,legacy_pos,0x99},
-			    {.flag=0xff}};
-#else
-  seg_or_flag the_line[] = {{0,0,0,0,pos,0xff},
-			    {.flag=0xff}};
-#endif
   // We'd like to assume that x0 is the left-most point, so make it so:
   if(x0 > x1){
-    uint8 tmp = x0;
+    int tmp = x0;
     x0 = x1;
     x1 = tmp;
 
@@ -143,40 +486,450 @@ void line(uint8 x0, uint8 y0, uint8 x1, uint8 y1,int which_buffer){
     y1 = tmp;
   }
 
-  the_line->seg_data.x_offset = (x0 + x1) / 2;
-  the_line->seg_data.y_offset = (y0 + y1) / 2;
+  the_line.x_offset = quantize((x0 + x1) / 2);
+  the_line.y_offset = quantize((y0 + y1) / 2);
+
+  the_line.x_size = quantize_size(x1 - x0);
+  the_line.y_size = quantize_size((y1 > y0) ? y1 - y0 : y0 - y1);
+
+  if(y1<y0)
+    the_line.arc_type = (rising == pos) ? neg : legacy_neg;
+
+  dl_append(&display_lists[which_buffer],&the_line);
+}
+
+// Ellipses can't be trimmed, only blanked an octant at a time.  Octants that never reach the clip square are
+// blanked, and the shape is culled if that leaves nothing, or if its center is off-screen and can't be encoded:
+static void emit_ellipse(int cx, int cy, int x_size, int y_size, uint8 mask, int which_buffer){
+  // octant k runs from 45k to 45(k+1) degrees; these are the cosines at its ends:
+  static const float boundary_cos[9] = {1.0f, 0.70710678f, 0.0f, -0.70710678f, -1.0f, -0.70710678f, 0.0f, 0.70710678f, 1.0f};
+  vc_segment the_ellipse = {quantize(cx), quantize(cy), quantize_size(x_size), quantize_size(y_size), cir, 0};
+  float rx = x_size / 2.0f, ry = y_size / 2.0f;
+  int k;
+
+  if(cx < clip_left || cx > clip_right || cy < clip_bottom || cy > clip_top){
+    segs_culled++;
+    return;
+  }
+
+  for(k = 0; k < 8; k++){
+    uint8 bit = 1 << ((5 - k) & 7);
+    float x_a, x_b, y_a, y_b;
+
+    if(!(mask & bit)) continue;
+    // the axes fall on octant boundaries, so an octant's extremes are its two ends:
+    x_a = cx + rx * boundary_cos[k];
+    x_b = cx + rx * boundary_cos[k + 1];
+    y_a = cy + ry * boundary_cos[(k + 6) % 8];    // sin(a) = cos(a - 90)
+    y_b = cy + ry * boundary_cos[(k + 7) % 8];
+    if((x_a < clip_left && x_b < clip_left) || (x_a > clip_right && x_b > clip_right) ||
+       (y_a < clip_bottom && y_b < clip_bottom) || (y_a > clip_top && y_b > clip_top))
+      continue;
+    the_ellipse.mask |= bit;
+  }
+
+  if(!the_ellipse.mask){
+    segs_culled++;
+    return;
+  }
+  if(the_ellipse.mask != mask) segs_clipped++;
+  dl_append(&display_lists[which_buffer],&the_ellipse);
+}
+
+// The lissajous figures have no octants to speak of, so they can only be culled whole, when their center is off-screen:
+static void emit_figure(int cx, int cy, int x_size, int y_size, shape figure, uint8 mask, int which_buffer){
+  vc_segment the_figure = {quantize(cx), quantize(cy), quantize_size(x_size), quantize_size(y_size), figure, mask};
+
+  if(cx < clip_left || cx > clip_right || cy < clip_bottom || cy > clip_top){
+    segs_culled++;
+    return;
+  }
+  dl_append(&display_lists[which_buffer],&the_figure);
+}
+
+void circle(int x0, int y0, int radius, int which_buffer){
+  emit_ellipse(x0 * VC_ONE, y0 * VC_ONE, radius * VC_ONE, radius * VC_ONE, 0xff, which_buffer);
+}
+void circle_fx(vc_coord x0, vc_coord y0, vc_coord radius, int which_buffer){
+  emit_ellipse(x0, y0, radius, radius, 0xff, which_buffer);
+}
 
-  the_line->seg_data.x_size =  x1-x0;
-  the_line->seg_data.y_size = (y1>y0) ? y1-y0 : y0-y1;
+void line(int x0, int y0, int x1, int y1, int which_buffer){
+  emit_line(x0 * VC_ONE, y0 * VC_ONE, x1 * VC_ONE, y1 * VC_ONE, LINE_TYPE, LINE_MASK, which_buffer);
+}
+void line_fx(vc_coord x0, vc_coord y0, vc_coord x1, vc_coord y1, int which_buffer){
+  emit_line(x0, y0, x1, y1, LINE_TYPE, LINE_MASK, which_buffer);
+}
 
-  if(y1<y0){
-    //the_line->seg_data.arc_type = legacy_neg;
-  #ifdef OLD_STYLE_LINES
-    the_line->seg_data.arc_type = legacy_neg;
-  #else
-    the_line->seg_data.arc_type = neg;
-  #endif
+// appends a retained layer to a buffer, (re)building it first if its key has changed:
+void draw_layer(retained_layer *layer, long key, void *context, int which_buffer){
+  display_list *scratch = &display_lists[LAYER_BUFFER];
+  display_list *dl = &display_lists[which_buffer];
+
+  if(!layer->valid || layer->key != key){
+    dl_clear(scratch);
+    layer->build(LAYER_BUFFER,context);
+    dl_clear(&layer->segs);
+    if(!dl_extend(&layer->segs,&scratch->segs->seg_data,scratch->length)) return;
+    layer->key = key;
+    layer->valid = 1;
+    layer->builds++;
   }
+  else layer->reuses++;
+
+  if(layer->keep_order) dl_begin_fixed_order(dl);
+  if(!dl_extend(dl,&layer->segs.segs->seg_data,layer->segs.length)) dl->overflows += layer->segs.length;
+  if(layer->keep_order) dl_end_fixed_order(dl);
+}
 
-  compileSegments(the_line,which_buffer, APPEND);
+// forces the next draw_layer() to rebuild the layer:
+void invalidate_layer(retained_layer *layer){
+  layer->valid = 0;
 }
 
 void copyBuf(int src_buffer_id,int dst_buffer_id){
-    seg_or_flag *src = seg_buffer[src_buffer_id];
-    seg_or_flag *dst = seg_buffer[dst_buffer_id];
+    display_list *src = &display_lists[src_buffer_id];
+    display_list *dst = &display_lists[dst_buffer_id];
+
+    if(!dl_reserve(dst,src->length)) return;
+    memcpy(dst->segs,src->segs,src->length * sizeof(seg_or_flag));
+    dst->length = src->length;
+    dst->n_fixed = src->n_fixed;
+    memcpy(dst->fixed_start,src->fixed_start,sizeof(dst->fixed_start));
+    memcpy(dst->fixed_end,src->fixed_end,sizeof(dst->fixed_end));
+    if(dst->length > dst->high_water) dst->high_water = dst->length;
+    dl_terminate(dst);  // add the sentinel value
+
+    dst->text_length = 0;
+    if(src->text_length && dl_reserve_text(dst,src->text_length)){
+      memcpy(dst->text,src->text,src->text_length);
+      dst->text_length = src->text_length;
+    }
+}
+
+// Converts an arc running counter-clockwise from start_angle to end_angle (degrees, 0 along +x) into an octant mask.
+// The hardware only blanks whole octants, so both ends are rounded to the nearest multiple of 45 degrees,
+// and at least one octant is always lit.  Octant k, spanning 45k..45k+45 degrees, is mask bit 5-k (mod 8).
+uint8 octant_mask(int start_angle, int end_angle){
+  int span = end_angle - start_angle;
+  int k, k0, k1;
+  uint8 mask = 0;
+
+  if(span >= 360 || span <= -360)
+    return 0xff;
+  span = ((span % 360) + 360) % 360;
+  start_angle = ((start_angle % 360) + 360) % 360;
+
+  k0 = (start_angle + 22) / 45;
+  k1 = (start_angle + span + 22) / 45;
+  if(k1 <= k0)
+    k1 = k0 + 1;
+
+  for(k = k0; k < k1; k++)
+    mask |= 1 << ((5 - k) & 7);
+  return mask;
+}
+
+// An elliptical arc centered at (x0,y0) with radii rx and ry, drawn counter-clockwise from start_angle to end_angle:
+void arc(int x0, int y0, int rx, int ry, int start_angle, int end_angle, int which_buffer){
+  emit_ellipse(x0 * VC_ONE, y0 * VC_ONE, 2 * rx * VC_ONE, 2 * ry * VC_ONE, octant_mask(start_angle, end_angle), which_buffer);
+}
+void arc_fx(vc_coord x0, vc_coord y0, vc_coord rx, vc_coord ry, int start_angle, int end_angle, int which_buffer){
+  emit_ellipse(x0, y0, 2 * rx, 2 * ry, octant_mask(start_angle, end_angle), which_buffer);
+}
+void ellipse_fx(vc_coord x0, vc_coord y0, vc_coord x_size, vc_coord y_size, uint8 mask, int which_buffer){
+  emit_ellipse(x0, y0, x_size, y_size, mask, which_buffer);
+}
+
+// The transform stack.  Operations compose the way OpenGL's do: each one applies to the content before the
+// ones already on the stack, so translate-then-rotate spins content in place and then moves it.
+static vc_transform transform_stack[TRANSFORM_STACK_DEPTH] = {{1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f}};
+static int transform_depth = 0;
+
+void push_transform(void){
+  if(transform_depth < TRANSFORM_STACK_DEPTH - 1){
+    transform_stack[transform_depth + 1] = transform_stack[transform_depth];
+    transform_depth++;
+  }
+}
+void pop_transform(void){
+  if(transform_depth > 0) transform_depth--;
+}
+void reset_transform(void){
+  vc_transform identity = {1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+
+  transform_depth = 0;
+  transform_stack[0] = identity;
+}
+
+void translate_transform(float dx, float dy){
+  vc_transform *t = &transform_stack[transform_depth];
+
+  t->tx += t->a * dx + t->b * dy;
+  t->ty += t->c * dx + t->d * dy;
+}
+void scale_transform(float sx, float sy){
+  vc_transform *t = &transform_stack[transform_depth];
+
+  t->a *= sx;
+  t->c *= sx;
+  t->b *= sy;
+  t->d *= sy;
+}
+// counter-clockwise, in degrees:
+void rotate_transform(float degrees){
+  vc_transform *t = &transform_stack[transform_depth];
+  float cos_a = cosf(degrees * (float)M_PI / 180.0f), sin_a = sinf(degrees * (float)M_PI / 180.0f);
+  float a = t->a, c = t->c;
+
+  t->a = a * cos_a + t->b * sin_a;
+  t->b = t->b * cos_a - a * sin_a;
+  t->c = c * cos_a + t->d * sin_a;
+  t->d = t->d * cos_a - c * sin_a;
+}
+
+// Transforms a run of segments by the top of the stack and appends them to which_buffer, clipping as the
+// primitives do.  Lines are transformed end point by end point, so they come out exact at any angle, and
+// keep their mask while the arc_type follows the new slope.  Ellipses stay axis aligned, so their rotation is rounded to the nearest
+// octant and applied by rotating the mask; at 90 and 270 degrees the sizes swap.  That's exact for circles
+// but only approximate for an ellipse turned by an odd multiple of 45 degrees.
+void transform_run(const vc_segment *run, int n, int which_buffer){
+  vc_transform t = transform_stack[transform_depth];
+  float x_scale = hypotf(t.a, t.c), y_scale = hypotf(t.b, t.d);
+  int mirrored = t.a * t.d - t.b * t.c < 0.0f;
+  int octants = ((int)lroundf(atan2f(t.c, t.a) * 4.0f / (float)M_PI) + 8) & 7;
+  int swap_sizes = (octants & 3) == 2;
+  int remap = octants || mirrored;    // plain moves and scales leave masks alone
+  uint8 mask_map[256];
+  int i, bit;
+
+  // everything but the segments themselves depends only on the transform, so work out the mask mapping once:
+  if(remap){
+    for(i = 0; i < 256; i++){
+      mask_map[i] = 0;
+      for(bit = 0; bit < 8; bit++){
+        if(i & (1 << bit)){
+          int b = mirrored ? (3 - bit) & 7 : bit;   // flipping y takes octant k to -1-k
+          mask_map[i] |= 1 << ((b - octants) & 7);  // turning by one octant moves each one a bit lower
+        }
+      }
+    }
+  }
+
+  for(i = 0; i < n; i++){
+    const vc_segment *seg = &run[i];
+    float x = seg->x_offset, y = seg->y_offset;
+    float cx = t.a * x + t.b * y + t.tx, cy = t.c * x + t.d * y + t.ty;
+
+    switch(seg->arc_type){
+    case legacy_pos: case legacy_neg: case pos: case neg: {
+      float half_x = seg->x_size / 2.0f;
+      float half_y = (seg->arc_type == legacy_neg || seg->arc_type == neg) ? -seg->y_size / 2.0f : seg->y_size / 2.0f;
+      float dx = t.a * half_x + t.b * half_y, dy = t.c * half_x + t.d * half_y;
+
+      emit_line(lroundf((cx - dx) * VC_ONE), lroundf((cy - dy) * VC_ONE),
+                lroundf((cx + dx) * VC_ONE), lroundf((cy + dy) * VC_ONE),
+                (seg->arc_type == pos || seg->arc_type == neg) ? pos : legacy_pos, seg->mask, which_buffer);
+      break;
+    }
+    case cir: {
+      float x_size = seg->x_size * x_scale, y_size = seg->y_size * y_scale;
+
+      if(swap_sizes){
+        float tmp = x_size;
+        x_size = y_size;
+        y_size = tmp;
+      }
+      emit_ellipse(lroundf(cx * VC_ONE), lroundf(cy * VC_ONE), lroundf(x_size * VC_ONE), lroundf(y_size * VC_ONE),
+                   remap ? mask_map[seg->mask] : seg->mask, which_buffer);
+      break;
+    }
+    default:
+      // the lissajous figures are just moved and sized:
+      emit_figure(lroundf(cx * VC_ONE), lroundf(cy * VC_ONE), lroundf(seg->x_size * x_scale * VC_ONE),
+                  lroundf(seg->y_size * y_scale * VC_ONE), seg->arc_type, seg->mask, which_buffer);
+      break;
+    }
+  }
+}
+
+// the same, for a sentinel-terminated list:
+void transformSegments(seg_or_flag *src_ptr, uint8 buffer_index, int append){
+  if(!append) dl_clear(&display_lists[buffer_index]);
+  transform_run(&src_ptr->seg_data,count_segments(src_ptr),buffer_index);
+}
+
+// static art is pre-terminated and knows its length, so it goes in as one block with no scan and no checks:
+void compileArt(const static_art *art, uint8 buffer_index, int append){
+  display_list *dl = &display_lists[buffer_index];
+
+  if(!append) dl_clear(dl);
+  if(!dl_extend(dl,&art->segs->seg_data,art->length)) dl->overflows += art->length;
+}
+void transformArt(const static_art *art, uint8 buffer_index, int append){
+  if(!append) dl_clear(&display_lists[buffer_index]);
+  transform_run(&art->segs->seg_data,art->length,buffer_index);
+}
+
+// appends a transformed copy of one buffer to another, e.g. to rotate a string compiled into a spare buffer:
+void transformBuf(int src_buffer, int dst_buffer){
+  display_list *src = &display_lists[src_buffer];
+
+  if(src_buffer == dst_buffer || !src->length) return;
+  transform_run(&src->segs->seg_data,src->length,dst_buffer);
+}
+
+// Marquees.  Each glyph is compiled at x = 0 so a string of any width fits the 8-bit wire format; its place in
+// the string is kept alongside, and drawing translates the glyphs in view to it, less the scroll:
+void set_marquee(marquee *m, const char *text, int y, uint8 scale, int left, int right){
+  int len = strlen(text), x = 0, kerning, i;
+  const char *p;
+
+  if(len > MARQUEE_MAX_CHARS) len = MARQUEE_MAX_CHARS;
+  if(m->compiles && !strncmp(m->text, text, len) && !m->text[len] && m->font == current_font() && m->y == y &&
+     m->scale == scale && m->left == left && m->right == right)
+    return;   // nothing new, so keep scrolling from where we are
+
+  memcpy(m->text, text, len);
+  m->text[len] = 0;
+  m->font = current_font();
+  m->y = y;
+  m->scale = scale;
+  m->left = left;
+  m->right = right;
+  m->restart = 1;
+  m->compiles++;
+
+  kerning = font_kerning(scale, utf8_length(m->text, len));
+  dl_clear(&m->segs);
+  for(p = m->text, i = 0; *p;){
+    const char *start = p;
+    glyph_ref glyph;
+
+    if(!font_glyph(m->font, utf8_next(&p, m->text + len), &glyph)) continue;
+    m->glyph_x[i] = x;
+    m->glyph_first[i] = m->segs.length;
+    if(!compile_glyphs(&m->segs, start, p - start, 0, y, scale, kerning)) break;
+    x += scale * glyph.width + kerning;
+    i++;
+  }
+  m->n_glyphs = i;
+  m->glyph_first[i] = m->segs.length;
+  m->width = i ? x - kerning : 0;
+}
+
+void draw_marquee(marquee *m, unsigned long now_ms, int which_buffer){
+  int window = m->right - m->left, period = 0, copy, i;
+  float scroll;
 
-    while(src->flag != 255){  // copy the segments
-        (dst++)->seg_data = (src++)->seg_data;
+  if(!m->n_glyphs) return;
+  if(m->restart){
+    m->start_ms = now_ms;
+    m->restart = 0;
+  }
+  if(m->width <= window)
+    scroll = m->left - ((m->left + m->right + 1) / 2 - m->width / 2);   // fits, so center it as compileString would
+  else{
+    // the text repeats, a quarter window apart.  The scroll is worked out in 12.4 so the motion is subpixel smooth:
+    unsigned long long travel = (unsigned long long)(now_ms - m->start_ms) * MARQUEE_SPEED * VC_ONE / 1000;
+
+    period = m->width + window / 4;
+    scroll = (float)(travel % ((unsigned long long)period * VC_ONE)) / VC_ONE;
+  }
+
+  set_clip_window(m->left, 0, m->right, 255);
+  for(copy = 0; copy < (period ? 2 : 1); copy++){
+    for(i = 0; i < m->n_glyphs; i++){
+      float x = m->left + m->glyph_x[i] - scroll + copy * period;
+      int advance = (i + 1 < m->n_glyphs ? m->glyph_x[i + 1] : m->width) - m->glyph_x[i];
+
+      if(x + advance < m->left || x > m->right) continue;
+      push_transform();
+      translate_transform(x, 0.0f);
+      transform_run(&m->segs.segs[m->glyph_first[i]].seg_data, m->glyph_first[i + 1] - m->glyph_first[i], which_buffer);
+      pop_transform();
     }
-    dst->flag = 255;  // add the sentinel value
+  }
+  reset_clip_window();
+}
+
+// Fills a box, given in 12.4 fixed point by its lower left corner and size, with whichever needs fewer segments: lissajous
+// figures side by side, or lines pitch pixels apart along its longer side.  A figure's trace sweeps its whole box,
+// crossing it FILL_FIGURE_LINES times each way, so one segment fills a box up to FILL_FIGURE_LINES * pitch pixels on
+// a side, and bigger boxes are split into as few equal tiles as that allows.  Every eighth of the trace is needed to
+// cover a tile, so the figures are unmasked.  Lines win for long thin boxes, and at fine pitches:
+static void fill_box(int x0, int y0, int width, int height, int pitch, int which_buffer){
+  int span = FILL_FIGURE_LINES * pitch * VC_ONE, step = pitch * VC_ONE;
+  int nx = (width + span - 1) / span, ny = (height + span - 1) / span;
+  int across = width < height ? width : height;
+  int n_lines = (across + step - 1) / step + 1;
+  int i, j;
+
+  if(nx < 1) nx = 1;
+  if(ny < 1) ny = 1;
+  if(n_lines < nx * ny){
+    // the last line always lands on the far edge, so the outline stays crisp whatever the pitch:
+    for(i = 0; i < n_lines; i++){
+      int p = (i + 1 < n_lines) ? i * step : across;
+
+      if(width < height)
+        emit_line(x0 + p, y0, x0 + p, y0 + height, LINE_TYPE, LINE_MASK, which_buffer);
+      else
+        emit_line(x0, y0 + p, x0 + width, y0 + p, LINE_TYPE, LINE_MASK, which_buffer);
+    }
+    return;
+  }
+  for(j = 0; j < ny; j++)
+    for(i = 0; i < nx; i++)
+      emit_figure(x0 + (2 * i + 1) * width / (2 * nx), y0 + (2 * j + 1) * height / (2 * ny), width / nx, height / ny,
+                  FILL_FIGURE, 0xff, which_buffer);
+}
+
+// Fills the rectangle with corners (x0,y0) and (x1,y1).  One that's only a pixel wide is just a line:
+void fill_rect(int x0, int y0, int x1, int y1, int pitch, int which_buffer){
+  if(x0 > x1){
+    int tmp = x0;
+    x0 = x1;
+    x1 = tmp;
+  }
+  if(y0 > y1){
+    int tmp = y0;
+    y0 = y1;
+    y1 = tmp;
+  }
+  if(pitch <= 0)
+    pitch = 1;
+
+  if(x0 == x1 || y0 == y1)
+    line(x0, y0, x1, y1, which_buffer);
+  else
+    fill_box(x0 * VC_ONE, y0 * VC_ONE, (x1 - x0) * VC_ONE, (y1 - y0) * VC_ONE, pitch, which_buffer);
 }
 
-void vertical_dashed_line(uint8 x0, uint8 y0, uint8 x1, uint8 y1,int which_buffer){
+// Fills a disc the size circle() would draw for size: rings pitch pixels apart work in from the rim until the square
+// inscribed in the innermost one leaves gaps no wider than pitch, and figures fill that square.  The gap, between
+// the middle of a side and the ring, is 1 - 1/sqrt(2) of the ring's radius, so that's when the radius is down to
+// about 3.4 * pitch:
+void fill_disc(int x0, int y0, int size, int pitch, int which_buffer){
+  int radius = size * VC_ONE / 2, half_side;
+
+  if(pitch <= 0)
+    pitch = 1;
+  for(;;){
+    circle_fx(x0 * VC_ONE, y0 * VC_ONE, 2 * radius, which_buffer);
+    if(radius * 29 <= pitch * VC_ONE * 100 || radius <= pitch * VC_ONE) break;
+    radius -= pitch * VC_ONE;
+  }
+  half_side = radius * 7071 / 10000;
+  fill_box(x0 * VC_ONE - half_side, y0 * VC_ONE - half_side, 2 * half_side, 2 * half_side, pitch, which_buffer);
+}
+
+void vertical_dashed_line(int x0, int y0, int x1, int y1,int which_buffer){
     int x2,y2,x3,y3;
 
   // We'd like to assume that y0 is the lowest point, so make it so:
   if(x0 > y1){
-    uint8 tmp = x0;
+    int tmp = x0;
     x0 = x1;
     x1 = tmp;
 
@@ -192,12 +945,7 @@ void vertical_dashed_line(uint8 x0, uint8 y0, uint8 x1, uint8 y1,int which_buffe
 }
 
 int buf_size(int which_buf){
-  seg_or_flag *buf_ptr = seg_buffer[which_buf];
-  int result = 0;
-  while((buf_ptr++)->flag != 255){
-    result += sizeof(seg_or_flag);
-  }
-  return (result + sizeof(seg_or_flag)); // adding the sentinel flag
+  return dl_size(&display_lists[which_buf]);    // includes the sentinel flag
 }
 
 
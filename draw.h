@@ -18,31 +18,230 @@
 #ifndef draw_h
 #define draw_h
 
+#include <stdint.h>
 #include "font.h"
 
 // constants plus buffers to hold drawlists:
-#define BUF_ENTRIES 300
+#define BUF_ENTRIES 300       // initial size of each display list.  Lists grow on demand..
+#define MAX_BUF_ENTRIES 4096  // ..up to this many entries
+#define MAX_FIXED_RANGES 16   // runs per list that the reordering stage must leave alone
 #define DEBUG_BUFFER 1
 #define MAIN_BUFFER 0
 #define AUX_BUFFER 2
+#define LAYER_BUFFER 3    // scratch buffer that retained layers are built in.  Never sent to the remote
+#define N_BUFFERS 4
 
 #define OVERWRITE 0
 #define APPEND 1
 
-extern seg_or_flag seg_buffer[3][BUF_ENTRIES];
+// A display list keeps track of its own length, so appending to it doesn't require a scan for the 0xff sentinel.
+// segs[length] always holds the sentinel, so segs can be handed to anything that expects a sentinel-terminated list.
+// Storage is allocated on first use and doubled when it fills, but never freed, so clearing a list each frame
+// reuses the same memory and steady state does no malloc:
+typedef struct {
+  seg_or_flag *segs;
+  int length;     // number of segments, not counting the sentinel
+  int capacity;   // number of entries in segs, including room for the sentinel
+
+  // accounting, so remote-side buffers can be sized from real data:
+  int high_water;   // longest the list has ever been
+  int overflows;    // segments dropped because the list reached MAX_BUF_ENTRIES
+  int grows;        // number of times storage was reallocated
+
+  // segments [fixed_start[i],fixed_end[i]) must be drawn in the order given.  See reorder_display_list():
+  int n_fixed;
+  int fixed_start[MAX_FIXED_RANGES];
+  int fixed_end[MAX_FIXED_RANGES];
+
+  // strings for the remote to expand itself, as packed text records.  See drawText():
+  uint8 *text;
+  int text_length, text_capacity;
+} display_list;
+
+extern display_list display_lists[N_BUFFERS];
+
+void dl_clear(display_list *dl);
+int dl_append(display_list *dl, vc_segment *seg);
+int dl_size(display_list *dl);
+const seg_or_flag *dl_segs(display_list *dl);
+void dl_begin_fixed_order(display_list *dl);
+void dl_end_fixed_order(display_list *dl);
 
 struct menu;  // "forward" definition of menu is fine for this purpose
 
+// A retained layer holds geometry that only changes when its inputs do (location, date, etc.)  The builder draws
+// the layer into the buffer it's handed, using the usual primitives.  The result is kept, and draw_layer() just
+// splices it into the frame until it's called with a different key:
+typedef void (*layer_builder)(int which_buffer, void *context);
+
+typedef struct {
+  layer_builder build;
+  long key;         // summarizes the inputs the layer was built from
+  int valid;
+  int keep_order;   // nonzero if the reordering stage must draw this layer's segments as built
+  display_list segs;
+  unsigned long builds, reuses;
+} retained_layer;
+
+#define RETAINED_LAYER(builder) {.build = (builder), .valid = 0}
+#define ORDERED_RETAINED_LAYER(builder) {.build = (builder), .valid = 0, .keep_order = 1}
+
+void draw_layer(retained_layer *layer, long key, void *context, int which_buffer);
+void invalidate_layer(retained_layer *layer);
+
+// glyph and string cache statistics for compileString:
+extern unsigned long glyph_cache_hits;
+extern unsigned long glyph_cache_misses;
+extern unsigned long string_cache_hits;
+extern unsigned long string_cache_misses;
+
 void clear_buffer(int which_buffer);
+
+// Remote text.  Once the remote holds a copy of the font atlas, drawText() adds a string to the buffer as one text
+// record -- x, y, scale, kerning, length and then the characters -- which the remote expands exactly as
+// compileString() would have.  x is resolved here, so 255 still centers.  Until remote_text is set (or if the
+// string is too long for a record), drawText() is just compileString():
+#define TEXT_RECORD_HEADER 5
+#define TEXT_RECORD_MAX_CHARS 255
+
+extern int remote_text;
+
+void drawText(char *s, uint8 x_coord, uint8 y_coord, uint8 buffer_index, uint8 scale, int append);
 void compileString(char *s, uint8 x_coord, uint8 y_coord,uint8 buffer_index,uint8 scale,int append);
 void compile_substring(char *s, uint8 count,uint8 x_coord, uint8 y_coord,uint8 which_buffer,uint8 scale,uint8 append);
 void compileSegments(seg_or_flag *src_ptr, uint8 buffer_index,int append);
-void offsetSegments(seg_or_flag *src_pre, uint8 x, uint8 y);
+void offsetSegments(seg_or_flag *src_pre, int x, int y);
 void insetSegments(seg_or_flag *src_pre, uint8 x, uint8 y);
 void compileMenu(struct menu* the_menu, uint8 buffer_index,int append);
-void circle(uint8 x0, uint8 y0, uint8 radius,int which_buffer);
-void line(uint8 x0, uint8 y0, uint8 x1, uint8 y1,int which_buffer);
-void vertical_dashed_line(uint8 x0, uint8 y0, uint8 x1, uint8 y1,int which_buffer);
+
+// The drawing primitives take pixel coordinates as ints, with 0..255 visible.  Lines are clipped to that square,
+// and circles and arcs lose the octants that fall outside it, so nothing wraps around.  Each primitive has an
+// _fx version that takes 12.4 fixed point for subpixel positioning; coordinates are only rounded to the wire
+// format once the segment is finished:
+// NOTE: line is temporarily using legacy pos/neg until I make a new analog board
+// Current analog filters make ends of sawtooth lines very slightly ragged/
+#define OLD_STYLE_LINES
+#ifdef OLD_STYLE_LINES
+#define LINE_TYPE legacy_pos
+#define LINE_MASK 0x99
+#else
+#define LINE_TYPE pos
+#define LINE_MASK 0xff
+#endif
+
+typedef int16_t vc_coord;
+#define VC_FRAC_BITS 4
+#define VC_ONE (1 << VC_FRAC_BITS)
+#define VC_FX(pixels) ((vc_coord)((pixels) * VC_ONE))
+
+void circle(int x0, int y0, int radius,int which_buffer);
+void circle_fx(vc_coord x0, vc_coord y0, vc_coord radius, int which_buffer);
+void line(int x0, int y0, int x1, int y1,int which_buffer);
+void line_fx(vc_coord x0, vc_coord y0, vc_coord x1, vc_coord y1, int which_buffer);
+// arcs take their radii (unlike circle(), whose size is the diameter) and angles in degrees, counter-clockwise
+// from +x.  The ends are rounded to the octant boundaries the hardware can blank at:
+void arc(int x0, int y0, int rx, int ry, int start_angle, int end_angle, int which_buffer);
+void arc_fx(vc_coord x0, vc_coord y0, vc_coord rx, vc_coord ry, int start_angle, int end_angle, int which_buffer);
+uint8 octant_mask(int start_angle, int end_angle);
+// an ellipse sized like circle(), with the octants already chosen as a segment's mask:
+void ellipse_fx(vc_coord x0, vc_coord y0, vc_coord x_size, vc_coord y_size, uint8 mask, int which_buffer);
+void vertical_dashed_line(int x0, int y0, int x1, int y1,int which_buffer);
+
+// filled shapes, covered with lissajous figures or parallel lines (and a disc's rim with rings).  pitch is the
+// spacing between the lines of the fill: 1 is solid and brightest, larger values trade brightness for fewer
+// segments.  fill_disc's size is the same as circle()'s:
+#define FILL_SOLID 1
+#define FILL_FIGURE lissajou5   // the densest figure,
+#define FILL_FIGURE_LINES 6     // whose trace crosses its box this many times each way
+void fill_rect(int x0, int y0, int x1, int y1, int pitch, int which_buffer);
+void fill_disc(int x0, int y0, int size, int pitch, int which_buffer);
+
+// The clip window, in pixels.  It's the whole screen unless narrowed, e.g. by a marquee:
+void set_clip_window(int x0, int y0, int x1, int y1);
+void reset_clip_window(void);
+
+// A stack of 2D affine transforms, x' = a*x + b*y + tx and y' = c*x + d*y + ty, applied by the transform calls
+// below.  Content can be compiled once and then moved, scaled or rotated each frame instead of being rebuilt:
+typedef struct {
+  float a, b, c, d;
+  float tx, ty;
+} vc_transform;
+
+#define TRANSFORM_STACK_DEPTH 8
+
+void push_transform(void);
+void pop_transform(void);
+void reset_transform(void);
+void translate_transform(float dx, float dy);
+void scale_transform(float sx, float sy);
+void rotate_transform(float degrees);
+void transform_run(const vc_segment *run, int n, int which_buffer);
+void transformSegments(seg_or_flag *src_ptr, uint8 buffer_index, int append);
+void transformBuf(int src_buffer, int dst_buffer);
+
+// A marquee scrolls a string too wide for its window.  The string is compiled once, when set_marquee() sees new
+// text, and each frame draw_marquee() just translates the glyphs in view, clipped to the window from left to right.
+// Text that fits is centered and holds still:
+#define MARQUEE_MAX_CHARS 128   // bytes of UTF-8
+#define MARQUEE_SPEED 40      // pixels per second
+
+typedef struct {
+  char text[MARQUEE_MAX_CHARS + 1];
+  vc_font *font;                            // the current font when the text was set
+  int y, left, right;
+  uint8 scale;
+  int width;                                // of the whole string, in pixels
+  int n_glyphs;
+  short glyph_x[MARQUEE_MAX_CHARS];         // where each glyph starts in the string
+  short glyph_first[MARQUEE_MAX_CHARS + 1]; // and its first segment in segs
+  display_list segs;                        // the glyphs, each compiled at x = 0
+  unsigned long start_ms;                   // when the text was first drawn; scrolling starts from its beginning
+  int restart;
+  unsigned long compiles;
+} marquee;
+
+void set_marquee(marquee *m, const char *text, int y, uint8 scale, int left, int right);
+void draw_marquee(marquee *m, unsigned long now_ms, int which_buffer);
+
+// Static art: fixed artwork declared once and built entirely by the compiler, e.g.
+//     STATIC_ART(dial_face, SEG_CIRCLE(128, 128, 254), SEG_LINE(8, 8, 248, 8));
+// gives a read-only, pre-terminated array plus its length.  Every coordinate is range checked while compiling
+// (a negative array size is the error), and art too long for a display list fails a _Static_assert.
+typedef struct {
+  const seg_or_flag *segs;  // terminated, so it can still go anywhere a sentinel list is expected
+  int length;               // not counting the sentinel
+} static_art;
+
+// 0..254 for positions, since 255 in x_offset ends a list, and 0..255 for sizes:
+#define SEG_CHECK(v, max) ((v) + 0 * sizeof(char[((v) >= 0 && (v) <= (max)) ? 1 : -1]))
+#define SEG_POS(v) SEG_CHECK(v, 254)
+#define SEG_SIZE(v) SEG_CHECK(v, 255)
+#define SEG_ABS(v) ((v) < 0 ? -(v) : (v))
+
+// any segment, spelled out:
+#define SEG_SHAPE(x, y, x_size, y_size, arc_type, mask) \
+  {{SEG_POS(x), SEG_POS(y), SEG_SIZE(x_size), SEG_SIZE(y_size), arc_type, mask}}
+// sizes are diameters, as for circle():
+#define SEG_CIRCLE(x, y, size) SEG_SHAPE(x, y, size, size, cir, 0xff)
+#define SEG_ELLIPSE(x, y, x_size, y_size, mask) SEG_SHAPE(x, y, x_size, y_size, cir, mask)
+// encodes the line from (x0,y0) to (x1,y1) the same way line() does.  Each falling arc_type follows its rising
+// partner in the enum:
+#define SEG_LINE(x0, y0, x1, y1) \
+  SEG_SHAPE(((x0) + (x1)) / 2, ((y0) + (y1)) / 2, SEG_ABS((x1) - (x0)), SEG_ABS((y1) - (y0)), \
+            ((x1) - (x0)) * ((y1) - (y0)) < 0 ? LINE_TYPE + 1 : LINE_TYPE, LINE_MASK)
+#define SEG_END {.flag = 0xff}
+
+#define STATIC_ART(name, ...) \
+  static const seg_or_flag name##_segs[] = {__VA_ARGS__, SEG_END}; \
+  _Static_assert(sizeof(name##_segs) / sizeof(seg_or_flag) - 1 <= MAX_BUF_ENTRIES, #name " won't fit in a display list"); \
+  static const static_art name = {name##_segs, sizeof(name##_segs) / sizeof(seg_or_flag) - 1}
+
+void compileArt(const static_art *art, uint8 buffer_index, int append);
+void transformArt(const static_art *art, uint8 buffer_index, int append);
+
+// segments trimmed or partly blanked to fit the screen, and ones dropped because nothing was left:
+extern unsigned long segs_clipped;
+extern unsigned long segs_culled;
 
 // some utilities for animation:
 void copyBuf(int src_buffer,int dst_buffer);
@@ -28,6 +28,8 @@
 #include <string.h>
 #include <sys/wait.h>
 #include <pthread.h>
+#include <poll.h>
+#include <errno.h>
 
 #include </usr/local/include/cjson/cJSON.h>
 
@@ -48,6 +50,12 @@
 #include <math.h>
 #include "font.h"
 #include "draw.h"
+#include "seg_kernels.h"
+#include "dl_optimize.h"
+#include "curve_fit.h"
+#include "frame_memo.h"
+#include "render_math.h"
+#include "compositor.h"
 
 #include "stdbool.h"
 #include <semaphore.h>
@@ -84,6 +92,27 @@ int n_auto_modes = 5;
 int switch_modes = 0;
 clock_type display_mode = sunriseMode;
 
+// what each clock face's output depends on, so that unchanged frames are reused rather than redrawn and resent.
+// Indexed like the switch in main():
+frame_memo mode_memos[16] = {
+    {.inputs = MEMO_SECOND},                                 // 0: analog clock
+    {.inputs = MEMO_SECOND},                                 // 1: lissajous figures, which change every few seconds
+    {.inputs = MEMO_MINUTE | MEMO_LOCATION},                 // 2: ip address, rechecked once a minute
+    {.inputs = MEMO_ANIMATED},                               // 3: pendulum
+    {.inputs = 0},                                           // 4: test pattern
+    {.inputs = MEMO_SECOND},                                 // 5: four letter words
+    {.inputs = MEMO_ANIMATED},                               // 6: pong
+    {.inputs = MEMO_MINUTE},                                 // 7: word clock
+    {.inputs = MEMO_MINUTE | MEMO_LOCATION},                 // 8: sun elevation
+    {.inputs = MEMO_MINUTE | MEMO_LOCATION},                 // 9: moon elevation
+    {.inputs = MEMO_ANIMATED},                               // 10: sunrise
+    {.inputs = MEMO_ANIMATED},                               // 11: moonrise
+    {.inputs = MEMO_DATA, .data_version = &btc_version},     // 12: bitcoin
+    {.inputs = MEMO_SECOND},                                 // 13: text clock
+    {.inputs = MEMO_DATA, .data_version = &weather_version}, // 14: weather
+    {.inputs = 0},                                           // 15: menagerie
+};
+
 char *month_names[] = {"January", "February", "March", "April", "May", "June", "July", "August", "September",
                        "October", "November", "December"};
 
@@ -162,15 +191,13 @@ int next_fps_check = 0;
 seg_or_flag fun_pattern[] = {
     {128, 128, 128, 128, lissajou0, 0x88},
     {.flag = 0xff}};
-seg_or_flag menagerie_pattern[] = {
-    {40, 208, 64, 64, lissajou0, 0x0ff},
-    {120, 208, 64, 64, lissajou1, 0x0ff},
-    {200, 208, 64, 64, lissajou2, 0x0ff},
-    {40, 75, 64, 64, lissajou3, 0x0ff},
-    {120, 75, 64, 64, lissajou4, 0x0ff},
-    {200, 75, 64, 64, lissajou5, 0x0ff},
-    {255, 255, 0, 0, cir, 0x00},
-};
+STATIC_ART(menagerie_pattern,
+           SEG_SHAPE(40, 208, 64, 64, lissajou0, 0x0ff),
+           SEG_SHAPE(120, 208, 64, 64, lissajou1, 0x0ff),
+           SEG_SHAPE(200, 208, 64, 64, lissajou2, 0x0ff),
+           SEG_SHAPE(40, 75, 64, 64, lissajou3, 0x0ff),
+           SEG_SHAPE(120, 75, 64, 64, lissajou4, 0x0ff),
+           SEG_SHAPE(200, 75, 64, 64, lissajou5, 0x0ff));
 vector_font test_pat = {
     {128, 128, 254, 254, cir, 0xff},
     {128, 254, 8, 8, cir, 0xff},
@@ -183,7 +210,9 @@ static struct location my_location = {.initialized = 0, .latitude = 0.0, .longit
 //static struct location my_location = {.initialized=1, .latitude=34.0, .longitude=117.0, .viewing_date=0, .gmt_offset=0};
 
 #define RPMSG_HEADER_LENGTH 12
-#define RPMSG_MAX_DATA_LENGTH (400 - RPMSG_HEADER_LENGTH) // ** TO DO: 400 is not the real number, but 512 is too big..
+#define RPMSG_BUFFER_SIZE 512                        // rpmsg's own buffers, of which it keeps 16 bytes for its header,
+#define RPMSG_MAX_MESSAGE (RPMSG_BUFFER_SIZE - 16)    // so no message can be longer than this
+#define RPMSG_MAX_DATA_LENGTH (400 - RPMSG_HEADER_LENGTH) // what we assume if the remote can't tell us (see CMD_GET_CAPABILITIES)
 
 #define CMD_START 0
 #define CMD_ADD 1
@@ -194,6 +223,152 @@ static struct location my_location = {.initialized = 0, .latitude = 0.0, .longit
 #define CMD_CHECK_CYCLES_IN_FRAME 6
 #define CMD_GET_KNOB_POSITION 7
 #define CMD_GET_BUTTON 8
+#define CMD_FONT_UPLOAD 9 // which_buf says which part of the font; each part's chunks are sent in order
+#define CMD_ADD_TEXT 10   // text records for which_buf, sent after its segments and before CMD_DONE
+#define CMD_SET_WINDOW 11 // data holds the window size we'd like (an int); see below
+#define CMD_GET_CAPABILITIES 12 // data holds our PROTOCOL_VERSION (an int); see below
+#define CMD_RESYNC 13           // see resync()
+
+// The capability handshake.  At startup we send CMD_GET_CAPABILITIES, and a remote that knows it answers with the
+// same cmd and a remote_capabilities as data.  Firmware that predates it answers with something else, and we keep to
+// RPMSG_MAX_DATA_LENGTH and don't limit segments.  Messages are sized from max_message, but never bigger than
+// RPMSG_MAX_MESSAGE nor too small for one segment.  A remote whose messages can't hold a whole text record doesn't
+// get remote text:
+#define PROTOCOL_VERSION 1
+#define REMOTE_FEATURE_TEXT 1   // takes CMD_FONT_UPLOAD and CMD_ADD_TEXT
+#define REMOTE_FEATURE_WINDOW 2 // takes CMD_SET_WINDOW
+#define REMOTE_FEATURE_RESYNC 4 // takes CMD_RESYNC
+#define MIN_DATA_LENGTH (TEXT_RECORD_HEADER + TEXT_RECORD_MAX_CHARS)
+
+typedef struct
+{
+  int protocol_version;
+  int max_message;     // the longest message it can take, header included
+  int buffer_capacity; // segments one of its display lists can hold, sentinel included; 0 if there's no limit
+  int features;        // REMOTE_FEATURE_ bits
+} remote_capabilities;
+
+static remote_capabilities remote_caps;              // all 0 until the remote answers
+static int max_data_length = RPMSG_MAX_DATA_LENGTH; // the data in any one message
+unsigned long remote_overflows = 0;                  // frames cut short to fit the remote's display list
+
+// Windowed transfers.  By default every message waits for its ack before the next is sent.  If the remote answers
+// CMD_SET_WINDOW with CMD_SET_WINDOW and a size > 1 (the window it grants), the messages of a frame (CMD_START,
+// CMD_ADD, CMD_ADD_TEXT and CMD_DONE) are instead sent up to that many at a time without waiting.  Each carries a
+// sequence number in the bits of which_buf above WINDOW_SEQ_SHIFT, counting on from frame to frame.  Acks are then
+// whole headers and cumulative: cmd is that of the latest message received in order, and size its sequence
+// number, which acknowledges every message before it too.  The remote acks at least every time its window fills,
+// and always for CMD_DONE.  Firmware that doesn't know CMD_SET_WINDOW answers with something else, and we stay with
+// stop-and-wait:
+#define WINDOW_SEQ_SHIFT 8
+#define WINDOW_SEQ_MASK 0xffff
+#define WINDOW_MAX 16
+
+// Waiting for the remote.  Replies are polled for, so the host sleeps instead of spinning while it waits, and
+// every exchange has a deadline.  A query that isn't answered in time is sent again, up to RPMSG_RETRIES times.  A
+// frame can't be patched up like that, so a frame message that isn't acked in time abandons the frame, the link is
+// resynchronized and the whole frame sent again, up to RPMSG_RETRIES times before it's dropped:
+#define ACK_TIMEOUT_MS 50        // for a frame message's ack
+#define QUERY_TIMEOUT_MS 100     // for the answer to a query
+#define HANDSHAKE_TIMEOUT_MS 500 // for the startup commands, which old firmware may not answer at all
+#define RPMSG_RETRIES 3
+
+unsigned long rpmsg_timeouts = 0; // replies that didn't come in time
+unsigned long rpmsg_retries = 0;  // queries and frames sent again
+unsigned long rpmsg_resyncs = 0;
+
+// a clock for deadlines, which unlike millis() doesn't jump when the time's set:
+static unsigned long deadline_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)(1000 * ts.tv_sec + ts.tv_nsec / 1000000);
+}
+
+// reads one reply, of up to len bytes, into r_payload.  Returns its length, or 0 if none came by the deadline:
+static int read_reply(int len, unsigned long deadline)
+{
+  struct pollfd pfd = {.fd = fd, .events = POLLIN};
+
+  for (;;)
+  {
+    unsigned long now = deadline_clock();
+    if (now >= deadline)
+    {
+      rpmsg_timeouts++;
+      return 0;
+    }
+    int ready = poll(&pfd, 1, (int)(deadline - now));
+    if (ready < 0 && errno != EINTR)
+    {
+      perror("poll on rpmsg device");
+      return 0;
+    }
+    if (ready > 0)
+    {
+      int bytes_read = read(fd, r_payload, len);
+      if (bytes_read > 0)
+        return bytes_read;
+    }
+  }
+}
+
+// sends the query in i_payload and waits for the answer, skipping any stale replies to earlier commands.  Returns
+// the answer's length, or 0 if the remote never gave one:
+static int rpmsg_query(int reply_len)
+{
+  for (int attempt = 0; attempt <= RPMSG_RETRIES; attempt++)
+  {
+    if (attempt)
+      rpmsg_retries++;
+    if (write(fd, i_payload, i_payload->size + RPMSG_HEADER_LENGTH) <= 0)
+    {
+      printf("\r\n****** Failed to write to remote device ******\r\n");
+      return 0;
+    }
+    unsigned long deadline = deadline_clock() + QUERY_TIMEOUT_MS;
+    int bytes_read;
+    while ((bytes_read = read_reply(reply_len, deadline)) > 0)
+      if (r_payload->cmd == i_payload->cmd)
+        return bytes_read;
+  }
+  return 0;
+}
+
+// sends a startup command in i_payload and returns the length of whatever the remote answers, or 0 if it doesn't:
+static int rpmsg_handshake(int reply_len)
+{
+  if (write(fd, i_payload, i_payload->size + RPMSG_HEADER_LENGTH) <= 0)
+    return 0;
+  return read_reply(reply_len, deadline_clock() + HANDSHAKE_TIMEOUT_MS);
+}
+
+// asks the remote what it can do, and sizes messages to match.  Returns false if it can't say:
+bool get_capabilities()
+{
+  int version = PROTOCOL_VERSION;
+
+  i_payload->cmd = CMD_GET_CAPABILITIES;
+  i_payload->size = sizeof(int);
+  i_payload->which_buf = 0;
+  memcpy(i_payload->data, &version, sizeof(int));
+  int bytes_read = rpmsg_handshake(RPMSG_BUFFER_SIZE);
+  if (bytes_read < RPMSG_HEADER_LENGTH + (int)sizeof(remote_capabilities) || r_payload->cmd != CMD_GET_CAPABILITIES)
+    return false; // firmware without the handshake
+  memcpy(&remote_caps, r_payload->data, sizeof(remote_capabilities));
+
+  int message = remote_caps.max_message < RPMSG_MAX_MESSAGE ? remote_caps.max_message : RPMSG_MAX_MESSAGE;
+  max_data_length = message - RPMSG_HEADER_LENGTH;
+  if (max_data_length < (int)sizeof(seg_or_flag))
+    max_data_length = sizeof(seg_or_flag);
+  if (max_data_length < MIN_DATA_LENGTH)
+    remote_caps.features &= ~REMOTE_FEATURE_TEXT;
+  return true;
+}
+
+// the parts of the font, in the order they're uploaded:
+#define FONT_PART_ATLAS 0
+#define FONT_PART_METRICS 1
 
 void check_ack(int expected, int received)
 {
@@ -207,120 +382,56 @@ void get_ack(int expect_ack, int len)
 {
   printf("get_ack %d\r\n", expect_ack);
   // get reply:
-  int bytes_read = 0;
-  do
-  {
-
-    bytes_read = read(fd, r_payload, len); // all
-
-  } while (bytes_read <= 0);
+  read_reply(len, deadline_clock() + QUERY_TIMEOUT_MS);
   check_ack(expect_ack, r_payload->cmd);
 }
 
+// the queries each return 0 if the remote doesn't answer:
 int check_fps()
 {
-  int result;
   i_payload->cmd = CMD_CHECK_FPS;
   i_payload->size = 0;
   i_payload->which_buf = MAIN_BUFFER;
-  int bytes_written = write(fd, i_payload, i_payload->size + RPMSG_HEADER_LENGTH);
-  if (bytes_written <= 0)
-    printf("\r\n****** Failed to write to remote device ******\r\b");
-#if 1
-  // get reply:
-  int bytes_read;
-  do
-  {
-    bytes_read = read(fd, r_payload, 12); // all
-
-  } while (bytes_read <= 0);
-  check_ack(CMD_CHECK_FPS, r_payload->cmd);
-#else
-  get_ack(CMD_CHECK_FPS, 12);
-#endif
+  if (!rpmsg_query(12))
+    return 0;
 
   //printf("check_fps received %d bytes\r\n",bytes_read);
-  result = r_payload->size;
-  // printf("returning %d\r\n", result);
-  return (result);
+  return r_payload->size;
 }
 
 int check_cycles_in_frame()
 {
-  int result;
   i_payload->cmd = CMD_CHECK_CYCLES_IN_FRAME;
   i_payload->size = 0;
   i_payload->which_buf = MAIN_BUFFER;
-  int bytes_written = write(fd, i_payload, i_payload->size + RPMSG_HEADER_LENGTH);
-  if (bytes_written <= 0)
-    printf("\r\n****** Failed to write to remote device ******\r\b");
-#if 1
-  // get reply:
-  int bytes_read;
-  do
-  {
-    bytes_read = read(fd, r_payload, 12); // all
-
-  } while (bytes_read <= 0);
-  check_ack(CMD_CHECK_CYCLES_IN_FRAME, r_payload->cmd);
-#else
-  get_ack(CMD_CHECK_CYCLES_IN_FRAME, 12);
-#endif
+  if (!rpmsg_query(12))
+    return 0;
 
   //printf("check_cycles_in_frame received %d bytes\r\n",bytes_read);
-  result = r_payload->size;
-  // printf("returning %d\r\n", result);
-  return (result);
+  return r_payload->size;
 }
+
+// ..except this one, which returns the last position it had, so the knob doesn't seem to move:
 int get_knob_position()
 {
-  int result;
+  static int last_position = 0;
+
   i_payload->cmd = CMD_GET_KNOB_POSITION;
   i_payload->size = 0;
   i_payload->which_buf = MAIN_BUFFER;
-  int bytes_written = write(fd, i_payload, i_payload->size + RPMSG_HEADER_LENGTH);
-  if (bytes_written <= 0)
-    printf("\r\n****** Failed to write to remote device ******\r\b");
-#if 1
-  // get reply:
-  int bytes_read;
-  do
-  {
-    bytes_read = read(fd, r_payload, 12); // all
-
-  } while (bytes_read <= 0);
-  check_ack(CMD_GET_KNOB_POSITION, r_payload->cmd);
-#else
-  get_ack(CMD_CHECK_CYCLES_IN_FRAME, 12);
-#endif
-
-  result = r_payload->size;
-  return (result);
+  if (rpmsg_query(12))
+    last_position = r_payload->size;
+  return last_position;
 }
+
 int get_button()
 {
-  int result;
   i_payload->cmd = CMD_GET_BUTTON;
   i_payload->size = 0;
   i_payload->which_buf = MAIN_BUFFER;
-  int bytes_written = write(fd, i_payload, i_payload->size + RPMSG_HEADER_LENGTH);
-  if (bytes_written <= 0)
-    printf("\r\n****** Failed to write to remote device ******\r\b");
-#if 1
-  // get reply:
-  int bytes_read;
-  do
-  {
-    bytes_read = read(fd, r_payload, 12); // all
-
-  } while (bytes_read <= 0);
-  check_ack(CMD_GET_BUTTON, r_payload->cmd);
-#else
-  get_ack(CMD_CHECK_CYCLES_IN_FRAME, 12);
-#endif
-
-  result = r_payload->size;
-  return (result);
+  if (!rpmsg_query(12))
+    return 0;
+  return r_payload->size;
 }
 
 int knob_motion()
@@ -351,28 +462,40 @@ int knob_motion()
 }
 int update_screen_saver(int x, int y)
 {
-  int result;
   i_payload->cmd = CMD_SS_OFFSETS;
   i_payload->size = 8;                // two ints
   i_payload->which_buf = MAIN_BUFFER; // not relevant in this case
   i_payload->data[0] = (unsigned char)x;
   i_payload->data[1] = (unsigned char)y;
+  return rpmsg_query(4) > 0; // header-only
+}
 
-  int bytes_written = write(fd, i_payload, i_payload->size + RPMSG_HEADER_LENGTH);
-  if (bytes_written <= 0)
-    printf("\r\n****** Failed to write to remote device ******\r\b");
-#if 1
-  // get reply:
-  int bytes_read;
-  do
+// Sends the font atlas and its metrics to the remote, so it can expand text records itself.  Returns false if the
+// remote doesn't acknowledge the upload, in which case drawText() stays on compileString():
+bool upload_font()
+{
+  const unsigned char *parts[] = {(const unsigned char *)font_atlas, (const unsigned char *)&system_metrics};
+  int part_sizes[] = {font_atlas_length * sizeof(seg_or_flag), sizeof(system_metrics)};
+
+  for (int part = FONT_PART_ATLAS; part <= FONT_PART_METRICS; part++)
   {
-    bytes_read = read(fd, r_payload, 4); // header-only
+    const unsigned char *src = parts[part];
+    int remaining = part_sizes[part];
 
-  } while (bytes_read <= 0);
-  check_ack(CMD_SS_OFFSETS, r_payload->cmd);
-#else
-  get_ack(CMD_SS_OFFSETS, 4);
-#endif
+    while (remaining > 0)
+    {
+      i_payload->cmd = CMD_FONT_UPLOAD;
+      i_payload->size = remaining > max_data_length ? max_data_length : remaining;
+      i_payload->which_buf = part;
+      memcpy(i_payload->data, src, i_payload->size);
+      if (!rpmsg_handshake(4) || r_payload->cmd != CMD_FONT_UPLOAD)
+        return false; // firmware without remote text
+
+      src += i_payload->size;
+      remaining -= i_payload->size;
+    }
+  }
+  return true;
 }
 
 // some features need sub-second time info.
@@ -384,96 +507,223 @@ float fractional_second()
   return (ts.tv_nsec / 1000000000.0);
 }
 
-void copy_seg_buffer(int which_buf)
+static int window_size = 1;                          // messages that may be in flight; 1 is stop-and-wait
+static unsigned int next_seq = 0, unacked_seq = 0;   // the next sequence number to send, and the oldest not acked
+static bool bad_window_ack = false;                  // the remote acked something that wasn't in flight
+unsigned long window_ack_waits = 0;                 // times a frame had to wait for an ack (round trips)
+
+// asks the remote for a window of up to requested messages, and returns the size it grants:
+int negotiate_window(int requested)
 {
-  int bytes_read = 0;
-  int data_bytes_to_send = buf_size(which_buf);
-  unsigned int t1 = 0, t0 = 0, total_bytes = 0, n_buffers = 0; // for performance tracking
+  if (requested > WINDOW_MAX)
+    requested = WINDOW_MAX;
+  i_payload->cmd = CMD_SET_WINDOW;
+  i_payload->size = sizeof(int);
+  i_payload->which_buf = 0;
+  memcpy(i_payload->data, &requested, sizeof(int));
+  int bytes_read = rpmsg_handshake(RPMSG_HEADER_LENGTH);
+  if (bytes_read < RPMSG_HEADER_LENGTH || r_payload->cmd != CMD_SET_WINDOW || r_payload->size < 2)
+    return window_size = 1; // firmware without windowing
+  window_size = r_payload->size < requested ? r_payload->size : requested;
+  next_seq = unacked_seq = 0;
+  return window_size;
+}
+
+// waits for the next cumulative ack, skipping any stale replies to other commands, and returns false if none comes in
+// time, or it doesn't acknowledge anything in flight (which sets bad_window_ack):
+static bool wait_for_window_ack()
+{
+  unsigned long deadline = deadline_clock() + ACK_TIMEOUT_MS;
+  int bytes_read;
 
-  // prepare first buffer
-  i_payload->cmd = CMD_START;
-  i_payload->size = data_bytes_to_send > RPMSG_MAX_DATA_LENGTH ? RPMSG_MAX_DATA_LENGTH : data_bytes_to_send;
+  window_ack_waits++;
+  do
+  {
+    bytes_read = read_reply(RPMSG_HEADER_LENGTH, deadline);
+    if (bytes_read == 0)
+      return false;
+  } while (r_payload->cmd != CMD_START && r_payload->cmd != CMD_ADD && r_payload->cmd != CMD_ADD_TEXT &&
+           r_payload->cmd != CMD_DONE);
+  unsigned int acked = (r_payload->size - unacked_seq) & WINDOW_SEQ_MASK; // how far past the oldest unacked it is
+  if (bytes_read < RPMSG_HEADER_LENGTH || acked >= next_seq - unacked_seq)
+  {
+    bad_window_ack = true;
+    return false;
+  }
+  unacked_seq += acked + 1;
+  return true;
+}
+
+// sends one message of a frame, waiting for its ack or for room in the window.  Returns false if it waited too long:
+static bool send_frame_message(int cmd, int which_buf, const void *data, int size)
+{
+  i_payload->cmd = cmd;
+  i_payload->size = size;
   i_payload->which_buf = which_buf;
-  unsigned char *src = (unsigned char *)seg_buffer[which_buf];
-  unsigned char *dst = i_payload->data;
+  if (size > 0)
+    memcpy(i_payload->data, data, size);
 
-  t0 = microseconds();
+  if (window_size > 1)
+  {
+    while (next_seq - unacked_seq >= (unsigned int)window_size)
+      if (!wait_for_window_ack())
+        return false;
+    i_payload->which_buf |= (next_seq & WINDOW_SEQ_MASK) << WINDOW_SEQ_SHIFT;
+  }
+  if (write(fd, i_payload, size + RPMSG_HEADER_LENGTH) <= 0)
+    return false;
+  if (window_size > 1)
+  {
+    next_seq++;
+    return true;
+  }
 
-  memcpy(dst, src, i_payload->size);
-  src += i_payload->size;
-  dst += i_payload->size;
+  // wait for the acknowledgement of the command we sent, skipping any stale ones:
+  unsigned long deadline = deadline_clock() + ACK_TIMEOUT_MS;
+  while (read_reply(4, deadline) > 0) // header-only
+    if (r_payload->cmd == cmd)
+      return true;
+  return false;
+}
 
-  // send first buffer:
-  //printf("sending data\r\n");
-  int bytes_written = write(fd, i_payload, i_payload->size + RPMSG_HEADER_LENGTH);
-  total_bytes += bytes_written;
-  n_buffers += 1;
-  //printf("waiting for data ack\r\n");
+// Resynchronizing after a frame's gone wrong: whatever the remote still sends is read and thrown away until it goes
+// quiet.  A remote with REMOTE_FEATURE_RESYNC is also sent CMD_RESYNC, which has it drop any frame it was part way
+// through and restart its sequence numbers; it answers CMD_RESYNC after any acks it still owed.  Any other remote
+// using a window has the window negotiated again, which restarts the numbers on both ends.  If neither works the
+// sequence numbers can't be trusted, and the transfer drops back to stop-and-wait:
+static void resync()
+{
+  struct pollfd pfd = {.fd = fd, .events = POLLIN};
+  bool restarted = false;
 
-#if 1
-  // wait for ack:
-  do
+  rpmsg_resyncs++;
+  while (poll(&pfd, 1, ACK_TIMEOUT_MS) > 0 && read(fd, r_payload, RPMSG_BUFFER_SIZE) > 0)
+    ;
+  if (remote_caps.features & REMOTE_FEATURE_RESYNC)
+  {
+    unsigned long deadline = deadline_clock() + QUERY_TIMEOUT_MS;
+
+    i_payload->cmd = CMD_RESYNC;
+    i_payload->size = 0;
+    i_payload->which_buf = 0;
+    if (write(fd, i_payload, RPMSG_HEADER_LENGTH) > 0)
+      while (read_reply(RPMSG_BUFFER_SIZE, deadline) > 0)
+        if (r_payload->cmd == CMD_RESYNC)
+        {
+          next_seq = unacked_seq = 0;
+          restarted = true;
+          break;
+        }
+  }
+  else if (window_size > 1)
+    restarted = negotiate_window(window_size) > 1;
+  if (window_size > 1 && !restarted)
   {
-    bytes_read = read(fd, r_payload, 4); // all
+    printf("windowed transfer lost sync; falling back to stop-and-wait\r\n");
+    window_size = 1;
+  }
+}
 
-  } while (bytes_read <= 0);
-  // confirm that the acknowlegement == the command we sent:
-  check_ack(CMD_START, r_payload->cmd);
-#else
-  get_ack(CMD_START, 4);
-#endif
+static unsigned int total_bytes = 0, n_buffers = 0; // in the last frame, for performance tracking
+
+// sends one buffer to the remote, and returns false if it wasn't acked in time:
+static bool send_frame(int which_buf)
+{
+  display_list *dl = &display_lists[which_buf];
+  int data_bytes_to_send = dl_size(dl);
+  const unsigned char *src = (const unsigned char *)dl_segs(dl);
+  int cmd = CMD_START;
+  bool ok = true, overflow = false;
 
-  //data_bytes_to_send -= i_payload->size;
-  data_bytes_to_send -= (bytes_written - RPMSG_HEADER_LENGTH);
+  total_bytes = n_buffers = 0;
 
-  // send additional buffers as required:
-  while (data_bytes_to_send > 0)
+  // more segments than the remote can hold are dropped, and the sentinel sent after the ones that fit:
+  if (remote_caps.buffer_capacity > 0 && dl->length >= remote_caps.buffer_capacity)
   {
-    dst = i_payload->data;
-    i_payload->size = data_bytes_to_send > RPMSG_MAX_DATA_LENGTH ? RPMSG_MAX_DATA_LENGTH : data_bytes_to_send;
-    i_payload->cmd = CMD_ADD;
-    i_payload->which_buf = which_buf;
-
-    //for(int i=0;i<i_payload->size;i++){
-    // *dst++ = *src++;
-    //}
-    memcpy(dst, src, i_payload->size);
-    src += i_payload->size;
-    dst += i_payload->size;
-
-    bytes_written = write(fd, i_payload, i_payload->size + RPMSG_HEADER_LENGTH);
-    total_bytes += bytes_written;
-    n_buffers += 1;
-    // wait for ack:
-    do
+    if (!remote_overflows++)
     {
-      bytes_read = read(fd, r_payload, 4); // all
-    } while (bytes_read <= 0);
-    check_ack(CMD_ADD, r_payload->cmd);
+      vc_log("frame of %d segments cut to the remote's %d\n", dl->length, remote_caps.buffer_capacity - 1);
+    }
+    data_bytes_to_send = (remote_caps.buffer_capacity - 1) * sizeof(seg_or_flag);
+    overflow = true;
+  }
 
-    data_bytes_to_send -= i_payload->size;
+  // the segments, the first message always CMD_START even for an empty list:
+  do
+  {
+    int size = data_bytes_to_send > max_data_length ? max_data_length : data_bytes_to_send;
+
+    ok = send_frame_message(cmd, which_buf, src, size);
+    total_bytes += size + RPMSG_HEADER_LENGTH;
+    n_buffers += 1;
+    src += size;
+    data_bytes_to_send -= size;
+    cmd = CMD_ADD;
+  } while (ok && data_bytes_to_send > 0);
+  if (ok && overflow)
+  {
+    ok = send_frame_message(CMD_ADD, which_buf, &dl->segs[dl->length], sizeof(seg_or_flag));
+    total_bytes += sizeof(seg_or_flag) + RPMSG_HEADER_LENGTH;
+    n_buffers += 1;
   }
 
-  // send a "done" cmd
-  //printf("sending done\r\n");
-  i_payload->cmd = CMD_DONE;
-  i_payload->size = 0;
-  i_payload->which_buf = which_buf;
-  bytes_written = write(fd, i_payload, i_payload->size + RPMSG_HEADER_LENGTH);
-  total_bytes += bytes_written;
+  // then any text records, as many whole records to a message as fit:
+  for (int text_sent = 0; ok && text_sent < dl->text_length;)
+  {
+    int size = 0;
+
+    while (text_sent + size < dl->text_length)
+    {
+      int record = TEXT_RECORD_HEADER + dl->text[text_sent + size + 4]; // byte 4 of a record is its length
+      if (size + record > max_data_length)
+        break;
+      size += record;
+    }
+    ok = send_frame_message(CMD_ADD_TEXT, which_buf, dl->text + text_sent, size);
+    total_bytes += size + RPMSG_HEADER_LENGTH;
+    n_buffers += 1;
+    text_sent += size;
+  }
+
+  // send a "done" cmd, and with a window, wait until everything's been acked:
+  if (ok)
+    ok = send_frame_message(CMD_DONE, which_buf, NULL, 0);
+  total_bytes += RPMSG_HEADER_LENGTH;
   n_buffers += 1;
+  while (ok && unacked_seq != next_seq)
+    ok = wait_for_window_ack();
+  return ok;
+}
 
-  // wait for ack:
-  //printf("awaiting DONE ack\r\n");
-  do
+// sends one buffer to the remote, resynchronizing and starting over if need be, and returns the microseconds it took:
+unsigned long copy_seg_buffer(int which_buf)
+{
+  unsigned int t1 = 0, t0 = 0;
+  int attempt;
+
+  t0 = microseconds();
+  for (attempt = 0; !send_frame(which_buf); attempt++)
   {
-    int bytes_read = read(fd, r_payload, 4); // all
-  } while (bytes_read <= 0);
-  check_ack(CMD_DONE, r_payload->cmd);
+    if (bad_window_ack)
+    {
+      // the remote didn't follow the windowed protocol after all, so carry on without it:
+      printf("windowed transfer failed; falling back to stop-and-wait\r\n");
+      window_size = 1;
+      bad_window_ack = false;
+    }
+    resync();
+    if (attempt == RPMSG_RETRIES)
+    {
+      vc_log("remote didn't take buffer %d after %d tries\n", which_buf, attempt + 1);
+      break;
+    }
+    rpmsg_retries++;
+  }
   t1 = microseconds();
   //if (microseconds() > next_fps_check)
   if (0)
     printf("copy_seg_buffer (%u bytes/%u buffers) took %u microseconds\r\n", total_bytes, n_buffers, t1 - t0);
+  return t1 - t0;
 }
 
 void dump512(unsigned char *char_ptr)
@@ -498,22 +748,25 @@ void read_back()
   // printf("wrote %d bytes (readback)\r\n",bytes_written);
 
   // wait for ack:
-  int bytes_read;
-  do
-  {
-    bytes_read = read(fd, r_payload, 512); // all
-
-  } while (bytes_read <= 0);
+  int bytes_read = read_reply(RPMSG_BUFFER_SIZE, deadline_clock() + QUERY_TIMEOUT_MS); // all
   unsigned char *char_ptr = (unsigned char *)r_payload;
   printf("%d bytes of remote buffer received:\r\n", bytes_read);
   dump512(char_ptr);
 
   printf("local buffer:\r\n");
-  char_ptr = (unsigned char *)seg_buffer[MAIN_BUFFER];
+  char_ptr = (unsigned char *)display_lists[MAIN_BUFFER].segs;
   dump512(char_ptr);
   printf("\r\nExiting read_back\r\n");
 }
 
+// changes whenever the location does, for the frame memo:
+unsigned long location_key(struct location *loc)
+{
+  // through long, since western and southern coordinates are negative:
+  return (unsigned long)lround(loc->latitude * 1000.0) * 31 + (unsigned long)lround(loc->longitude * 1000.0) * 17 +
+         loc->gmt_offset + loc->initialized;
+}
+
 int sync_window()
 {
   struct timespec ts;
@@ -526,6 +779,83 @@ int sync_window()
   return (1);
 }
 
+// Performance HUD, drawn into DEBUG_BUFFER in the lower left corner.  Each of the remote's counters costs a round
+// trip, so they're only polled every couple of seconds; host times are averaged over the frames since the last refresh:
+#define HUD_REFRESH_US 500000
+#define HUD_REMOTE_POLL_US 2000000
+
+bool show_hud = false;
+
+typedef struct
+{
+  unsigned long next_refresh, next_remote_poll;
+  int remote_fps, remote_cycles;
+  unsigned long render_us, transport_us; // totals since the last refresh
+  int renders, sends;
+} perf_hud;
+
+perf_hud hud;
+
+// render_us is 0 for a frame that was reused rather than rendered, and transport_us is 0 if nothing was sent:
+void render_perf_hud(unsigned long render_us, unsigned long transport_us)
+{
+  unsigned long now = microseconds();
+  char line[32];
+
+  if (render_us)
+  {
+    hud.render_us += render_us;
+    hud.renders++;
+  }
+  if (transport_us)
+  {
+    hud.transport_us += transport_us;
+    hud.sends++;
+  }
+  if (now < hud.next_refresh)
+    return;
+  if (now >= hud.next_remote_poll)
+  {
+    hud.remote_fps = check_fps();
+    hud.remote_cycles = check_cycles_in_frame();
+    hud.next_remote_poll = now + HUD_REMOTE_POLL_US;
+  }
+
+  sprintf(line, "TO %lu RT %lu AW %lu", rpmsg_timeouts, rpmsg_retries, window_ack_waits);
+  compileString(line, 4, 100, DEBUG_BUFFER, 1, OVERWRITE);
+  sprintf(line, "FPS %d", hud.remote_fps);
+  compileString(line, 4, 76, DEBUG_BUFFER, 1, APPEND);
+  sprintf(line, "CYC %d", hud.remote_cycles);
+  compileString(line, 4, 52, DEBUG_BUFFER, 1, APPEND);
+  sprintf(line, "REN %lu", hud.renders ? hud.render_us / hud.renders : 0);
+  compileString(line, 4, 28, DEBUG_BUFFER, 1, APPEND);
+  sprintf(line, "TX %lu", hud.sends ? hud.transport_us / hud.sends : 0);
+  compileString(line, 4, 4, DEBUG_BUFFER, 1, APPEND);
+
+  hud.render_us = hud.transport_us = 0;
+  hud.renders = hud.sends = 0;
+  hud.next_refresh = now + HUD_REFRESH_US;
+}
+
+// Statistics, printed every -v seconds or whenever the fifo says 'v':
+unsigned long stats_interval_us = 0, next_stats_report = 0;
+
+void print_stats()
+{
+  printf("display list high water = %d, overflows = %d, grows = %d\r\n", display_lists[MAIN_BUFFER].high_water,
+         display_lists[MAIN_BUFFER].overflows, display_lists[MAIN_BUFFER].grows);
+  printf("glyph cache hits = %lu, misses = %lu\r\n", glyph_cache_hits, glyph_cache_misses);
+  printf("string cache hits = %lu, misses = %lu\r\n", string_cache_hits, string_cache_misses);
+  printf("optimizer: %d -> %d segments (%d dropped, %d duplicates, %d merged)\r\n", last_opt_stats.segs_in,
+         last_opt_stats.segs_out, last_opt_stats.dropped, last_opt_stats.duplicates, last_opt_stats.merged);
+  printf("beam travel: %d -> %d\r\n", last_reorder_stats.travel_before, last_reorder_stats.travel_after);
+  printf("segments clipped = %lu, culled = %lu\r\n", segs_clipped, segs_culled);
+  printf("rpmsg timeouts = %lu, retries = %lu, resyncs = %lu, window ack waits = %lu\r\n", rpmsg_timeouts,
+         rpmsg_retries, rpmsg_resyncs, window_ack_waits);
+  frame_memo_report(mode_memos, nmodes);
+  composite_report();
+}
+
 void render_ip_address()
 {
   int fd;
@@ -617,7 +947,7 @@ void render_lissajou_buffer(time_t now, struct tm *local_bdt, struct tm *utc_bdt
 void render_menagerie(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
 {
 
-  compileSegments(menagerie_pattern, MAIN_BUFFER, OVERWRITE);
+  compileArt(&menagerie_pattern, MAIN_BUFFER, OVERWRITE);
 }
 
 void countdown_to_event(time_t now, time_t event_time, char *caption0, char *caption1)
@@ -675,18 +1005,18 @@ void render_BTC_buffer(time_t now)
 }
 
 /*  Pendulum Clock *** */
+#define BOB_FILL_PITCH 4    // spacing of the fill in the pendulum bob, as its rings were
 void render_pendulum_buffer(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
 {
   char sec_str[32], hr_min_string[32];
-  double x, y, i;
-  double f;
+  vc_coord x, y;
+  vc_angle swing;
+  int16_t s, c;
 
   const int pendulum_length = 180;
   const int origin_x = 128;
   const int origin_y = 230;
 
-  f = fractional_second();
-
   // render the time in seconds
   sprintf(sec_str, "%02i", local_bdt->tm_sec);
   compileString(sec_str, 255, 32, MAIN_BUFFER, 2, OVERWRITE);
@@ -695,14 +1025,15 @@ void render_pendulum_buffer(time_t now, struct tm *local_bdt, struct tm *utc_bdt
   sprintf(hr_min_string, "%02i:%02i", local_bdt->tm_hour, local_bdt->tm_min);
   compileString(hr_min_string, 255, 115, MAIN_BUFFER, 3, APPEND);
 
-  // render the pendulum shaft:
-  x = origin_x + pendulum_length * sin(sin(2 * M_PI * (f)) / 2.5);
-  y = origin_y - pendulum_length * cos(sin(2 * M_PI * (f)) / 2.5);
-  line(origin_x, origin_y, x, y, MAIN_BUFFER);
+  // render the pendulum shaft.  It swings 0.4 radians either side of straight down, once a second:
+  swing = (int32_t)fast_sin(ANGLE_TURNS(fractional_second())) * ANGLE_RADIANS(0.4) / TRIG_ONE;
+  fast_sincos(swing, &s, &c);
+  x = VC_FX(origin_x) + (int32_t)VC_FX(pendulum_length) * s / TRIG_ONE;
+  y = VC_FX(origin_y) - (int32_t)VC_FX(pendulum_length) * c / TRIG_ONE;
+  line_fx(VC_FX(origin_x), VC_FX(origin_y), x, y, MAIN_BUFFER);
 
   //render the pendulum bob:
-  for (i = 32; i > 0; i -= 8)
-    circle(x, y, i, MAIN_BUFFER);
+  fill_disc(x / VC_ONE, y / VC_ONE, 32, BOB_FILL_PITCH, MAIN_BUFFER);
 
   //render the point from which the pendulum swings:
   circle(origin_x, origin_y, 8, MAIN_BUFFER);
@@ -728,9 +1059,10 @@ void drawClockHands(int h, int m, int s)
 {
   if (h > 11)
     h -= 12;                                                                 // hours > 12 folded into 0-11
-  float hour_angle = (h / 12.0) * M_PI * 2.0 + (m / 60.0) * (M_PI / 6.0);    // hour hand angle (we'll ignore the seconds)
-  float minute_angle = (m / 60.0) * M_PI * 2.0 + (s / 60.0) * (M_PI / 30.0); // minute hand angle
-  float second_angle = (((s /* + fractional_second()*/) / 60.0)) * M_PI * 2.0;
+  vc_angle hour_angle = ANGLE_PART(h * 60 + m, 12 * 60);     // hour hand angle (we'll ignore the seconds)
+  vc_angle minute_angle = ANGLE_PART(m * 60 + s, 60 * 60);   // minute hand angle
+  vc_angle second_angle = ANGLE_PART(s /* + fractional_second()*/, 60);
+  vc_coord x, y;
 
   /*
     if(1){
@@ -740,28 +1072,37 @@ void drawClockHands(int h, int m, int s)
   */
 
   // not doing the 2-d hands yet, just lines
-  line(128, 128, 128 + sin(hour_angle) * HR_HAND_LENGTH, 128 + cos(hour_angle) * HR_HAND_LENGTH, MAIN_BUFFER); // draw the hour hand
-  line(128, 128, 128 + sin(minute_angle) * MIN_HAND_LENGTH, 128 + cos(minute_angle) * MIN_HAND_LENGTH, MAIN_BUFFER);
+  dial_fx(VC_FX(128), VC_FX(128), VC_FX(HR_HAND_LENGTH), hour_angle, &x, &y);
+  line_fx(VC_FX(128), VC_FX(128), x, y, MAIN_BUFFER); // draw the hour hand
+  dial_fx(VC_FX(128), VC_FX(128), VC_FX(MIN_HAND_LENGTH), minute_angle, &x, &y);
+  line_fx(VC_FX(128), VC_FX(128), x, y, MAIN_BUFFER);
   if (1)
   {
-    line(128, 128, 128 + sin(second_angle) * SEC_HAND_LENGTH, 128 + cos(second_angle) * SEC_HAND_LENGTH, MAIN_BUFFER);
+    dial_fx(VC_FX(128), VC_FX(128), VC_FX(SEC_HAND_LENGTH), second_angle, &x, &y);
+    line_fx(VC_FX(128), VC_FX(128), x, y, MAIN_BUFFER);
   }
 }
 
+// the dial and numerals never change, so they're built once as a retained layer:
+STATIC_ART(dial_face,
+           SEG_CIRCLE(128, 128, 254),
+           SEG_CIRCLE(128, 128, 8));
+
+void build_analog_dial(int which_buffer, void *context)
+{
+  compileArt(&dial_face, which_buffer, APPEND);
+  compileString("12", 112, 216, which_buffer, 1, APPEND);
+  compileString("6", 120, 20, which_buffer, 1, APPEND);
+  compileString("3", 220, 120, which_buffer, 1, APPEND);
+  compileString("9", 20, 120, which_buffer, 1, APPEND);
+}
+
 void renderAnalogClockBuffer(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
 {
-  int i;
-  float angle = 0.0;
-  static char *nums[12] = {"12", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11"};
-  seg_or_flag face[] = {{128, 128, 254, 254, cir, 0xff},
-                        {128, 128, 8, 8, cir, 0xff},
-                        // {0,0,255,0,pos,0xff},
-                        {.flag = 0xff}};
-  compileSegments(face, MAIN_BUFFER, OVERWRITE);
-  compileString("12", 112, 216, MAIN_BUFFER, 1, APPEND);
-  compileString("6", 120, 20, MAIN_BUFFER, 1, APPEND);
-  compileString("3", 220, 120, MAIN_BUFFER, 1, APPEND);
-  compileString("9", 20, 120, MAIN_BUFFER, 1, APPEND);
+  static retained_layer dial = RETAINED_LAYER(build_analog_dial);
+
+  clear_buffer(MAIN_BUFFER);
+  draw_layer(&dial, 0, NULL, MAIN_BUFFER);
 
   drawClockHands(local_bdt->tm_hour, local_bdt->tm_min, local_bdt->tm_sec);
 
@@ -790,12 +1131,12 @@ void render_word_clock(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
       sprintf(time_string[0], "It's exactly");
     else
       sprintf(time_string[0], "It's about");
-    compileString(time_string[0], 255, 160, MAIN_BUFFER, 2, OVERWRITE);
+    drawText(time_string[0], 255, 160, MAIN_BUFFER, 2, OVERWRITE);
     int the_hour = local_bdt->tm_min > 56 ? local_bdt->tm_hour + 1 : local_bdt->tm_hour;
     sprintf(time_string[0], "%s ", hour_strings[the_hour % 12]);
-    compileString(time_string[0], 255, 108, MAIN_BUFFER, 2, APPEND);
+    drawText(time_string[0], 255, 108, MAIN_BUFFER, 2, APPEND);
     sprintf(time_string[0], "O'clock");
-    compileString(time_string[0], 255, 50, MAIN_BUFFER, 2, APPEND);
+    drawText(time_string[0], 255, 50, MAIN_BUFFER, 2, APPEND);
     return;
   }
 
@@ -804,13 +1145,13 @@ void render_word_clock(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
     if (local_bdt->tm_min > 27 && local_bdt->tm_min < 33)
     {
       if (local_bdt->tm_min == 30)
-        compileString("It's exactly", 255, 150, MAIN_BUFFER, 2, OVERWRITE);
+        drawText("It's exactly", 255, 150, MAIN_BUFFER, 2, OVERWRITE);
       else
-        compileString("It's about", 255, 150, MAIN_BUFFER, 2, OVERWRITE);
+        drawText("It's about", 255, 150, MAIN_BUFFER, 2, OVERWRITE);
 
-      compileString("half past", 255, 100, MAIN_BUFFER, 2, APPEND);
+      drawText("half past", 255, 100, MAIN_BUFFER, 2, APPEND);
       sprintf(time_string[0], "%s", hour_strings[local_bdt->tm_hour % 12]);
-      compileString(time_string[0], 255, 50, MAIN_BUFFER, 2, APPEND);
+      drawText(time_string[0], 255, 50, MAIN_BUFFER, 2, APPEND);
       return;
     }
     else
@@ -825,39 +1166,39 @@ void render_word_clock(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
       exact = (approx_minute == local_bdt->tm_min);
 
       if (exact)
-        compileString("It's exactly", 255, 200, MAIN_BUFFER, 2, OVERWRITE);
+        drawText("It's exactly", 255, 200, MAIN_BUFFER, 2, OVERWRITE);
       else
-        compileString("It's about", 255, 200, MAIN_BUFFER, 2, OVERWRITE);
+        drawText("It's about", 255, 200, MAIN_BUFFER, 2, OVERWRITE);
       if (local_bdt->tm_min <= 27)
       {
         past_until_index = approx_minute / 5;
         sprintf(time_string[0], "%s", minute_strings[past_until_index]);
-        compileString(time_string[0], 255, 150, MAIN_BUFFER, 2, APPEND);
+        drawText(time_string[0], 255, 150, MAIN_BUFFER, 2, APPEND);
         sprintf(time_string[0], "past");
-        compileString(time_string[0], 255, 100, MAIN_BUFFER, 2, APPEND);
+        drawText(time_string[0], 255, 100, MAIN_BUFFER, 2, APPEND);
         sprintf(time_string[0], "%s", hour_strings[local_bdt->tm_hour % 12]);
-        compileString(time_string[0], 255, 50, MAIN_BUFFER, 2, APPEND);
+        drawText(time_string[0], 255, 50, MAIN_BUFFER, 2, APPEND);
       }
       if (local_bdt->tm_min >= 33)
       {
         approx_minute = 60 - approx_minute;
         past_until_index = approx_minute / 5;
         sprintf(time_string[0], "%s", minute_strings[(approx_minute / 5)]);
-        compileString(time_string[0], 255, 150, MAIN_BUFFER, 2, APPEND);
+        drawText(time_string[0], 255, 150, MAIN_BUFFER, 2, APPEND);
         sprintf(time_string[0], "'till");
-        compileString(time_string[0], 255, 100, MAIN_BUFFER, 2, APPEND);
+        drawText(time_string[0], 255, 100, MAIN_BUFFER, 2, APPEND);
         sprintf(time_string[0], "%s", hour_strings[((local_bdt->tm_hour + 1)) % 12]);
-        compileString(time_string[0], 255, 50, MAIN_BUFFER, 2, APPEND);
+        drawText(time_string[0], 255, 50, MAIN_BUFFER, 2, APPEND);
       }
       /*           if(now->Min >= 28 && now->Min<=32){
-                compileString("It's about",255,200,MAIN_BUFFER,2,OVERWRITE);
+                drawText("It's about",255,200,MAIN_BUFFER,2,OVERWRITE);
                 past_until_index = approx_minute / 5;
                 sprintf(time_string[0],"half");
-                compileString(time_string[0],255,150,MAIN_BUFFER,2,APPEND);
+                drawText(time_string[0],255,150,MAIN_BUFFER,2,APPEND);
                 sprintf(time_string[0],"past");
-                compileString(time_string[0],255,100,MAIN_BUFFER,2,APPEND);
+                drawText(time_string[0],255,100,MAIN_BUFFER,2,APPEND);
                 sprintf(time_string[0],"%s",hour_strings[now->Hour % 12]);
-                compileString(time_string[0],255,50,MAIN_BUFFER,2,APPEND);
+                drawText(time_string[0],255,50,MAIN_BUFFER,2,APPEND);
             }
 */
     }
@@ -867,6 +1208,7 @@ void render_word_clock(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
 /* ************* Pong Game ************* */
 #define PADDLE_HEIGHT 24
 #define PADDLE_WIDTH 8
+#define PONG_FILL_PITCH 2   // spacing of the fill in the paddles and puck
 #define PONG_TOP 250
 #define PONG_BOTTOM 4
 #define PONG_LEFT PADDLE_WIDTH
@@ -1084,43 +1426,39 @@ void pong_update()
 
 void draw_paddles(pong_state the_state)
 {
-  int y;
   // draw the left paddle
-  for (y = the_state.paddle_position[0] - (PADDLE_HEIGHT / 2); y < the_state.paddle_position[0] + (PADDLE_HEIGHT / 2) + 1; y++)
-    line(0, y, PADDLE_WIDTH, y, MAIN_BUFFER);
+  fill_rect(0, the_state.paddle_position[0] - (PADDLE_HEIGHT / 2), PADDLE_WIDTH, the_state.paddle_position[0] + (PADDLE_HEIGHT / 2), PONG_FILL_PITCH, MAIN_BUFFER);
   // draw the right paddle:
-  for (y = the_state.paddle_position[1] - (PADDLE_HEIGHT / 2); y < the_state.paddle_position[1] + (PADDLE_HEIGHT / 2) + 1; y++)
-    line(255 - PADDLE_WIDTH, y, 255, y, MAIN_BUFFER);
+  fill_rect(255 - PADDLE_WIDTH, the_state.paddle_position[1] - (PADDLE_HEIGHT / 2), 255, the_state.paddle_position[1] + (PADDLE_HEIGHT / 2), PONG_FILL_PITCH, MAIN_BUFFER);
 }
 
 void draw_puck(pong_state the_state)
 {
   int x, y;
   x = the_state.puck_position[0];
-  for (y = the_state.puck_position[1] - 2; y < the_state.puck_position[1] + 3; y++)
-    line(x - 2, y, x + 2, y, MAIN_BUFFER);
+  y = the_state.puck_position[1];
+  fill_rect(x - 2, y - 2, x + 2, y + 2, PONG_FILL_PITCH, MAIN_BUFFER);
 }
 void draw_celeb(pong_state the_state)
 {
-  int x, y, r;
-  x = the_state.puck_position[0];
-  y = the_state.puck_position[1];
-  for (r = 2; r < 32; r += 8)
-  {
-    circle(x, y, r, MAIN_BUFFER);
-  }
+  fill_disc(the_state.puck_position[0], the_state.puck_position[1], 26, 4, MAIN_BUFFER);
 }
 
-void draw_center_line(pong_state the_state)
+void build_center_line(int which_buffer, void *context)
 {
-  int x, y;
-  x = 128;
+  int y;
   for (y = PONG_TOP; y > 0; y -= 32)
   {
-    line(128, y, 128, y - 16, MAIN_BUFFER);
+    line(128, y, 128, y - 16, which_buffer);
   }
 }
 
+void draw_center_line(pong_state the_state)
+{
+  static retained_layer center_line = RETAINED_LAYER(build_center_line);
+  draw_layer(&center_line, 0, NULL, MAIN_BUFFER);
+}
+
 void draw_scores(pong_state the_state, struct tm *local_bdt)
 { // draw the hours and minutes as two scores:
   char time_str[32];
@@ -1134,17 +1472,13 @@ void draw_scores(pong_state the_state, struct tm *local_bdt)
 }
 void draw_tick(int seconds)
 { // draw a seconds tick
-  float second_angle = ((seconds / 60.0)) * M_PI * 2.0;
-  float x0 = 128 + 60 * sin(second_angle);
-  float y0 = 128 + 60 * cos(second_angle);
-  x0 = 128;
-  y0 = 128;
-  float x1 = 128 + 64 * sin(second_angle);
-  float y1 = 132 + 64 * cos(second_angle);
+  vc_coord x1, y1;
+
+  dial_fx(VC_FX(128), VC_FX(132), VC_FX(64), ANGLE_PART(seconds, 60), &x1, &y1);
   circle(128, 132, 8, MAIN_BUFFER);
   circle(128, 132, 80, MAIN_BUFFER);
 
-  line(x0, y0, x1, y1, MAIN_BUFFER);
+  line_fx(VC_FX(128), VC_FX(128), x1, y1, MAIN_BUFFER);
 }
 void render_pong_buffer(pong_state the_state, time_t now, struct tm *local_bdt, struct tm *utc_bdt)
 {
@@ -1182,15 +1516,15 @@ void render_text_clock(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
   int year = local_bdt->tm_year + 1900;
 
   sprintf(time_string, "%i:%02i:%02i", hours, minutes, seconds);
-  compileString(time_string, 255, 46, MAIN_BUFFER, 3, OVERWRITE);
+  drawText(time_string, 255, 46, MAIN_BUFFER, 3, OVERWRITE);
 
   sprintf(date_string, "%s %i, %i", month_names[month], day_of_month, year);
 
-  compileString(date_string, 255, 142, MAIN_BUFFER, 1, APPEND);
+  drawText(date_string, 255, 142, MAIN_BUFFER, 1, APPEND);
 
   char dw[12];
   sprintf(dw, "%s", day_names[day_of_week]);
-  compileString(dw, 255, 202, MAIN_BUFFER, 2, APPEND);
+  drawText(dw, 255, 202, MAIN_BUFFER, 2, APPEND);
 }
 
 double julian_date(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
@@ -1238,42 +1572,122 @@ void render_flw(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
 // Sun elevation diagram, as inspired by SGITeach:
 #define LEFT_MARGIN 8
 #define RIGHT_MARGIN 248
+#define ELEV_CURVE_TOLERANCE 2.0 // how far, in pixels, the drawn elevation curve may stray from the samples
 
-void renderSunOrMoonElev(time_t now, struct tm *local_bdt, struct tm *utc_bdt, int zeroForSunOneForMoon)
+// elevation data for the sun [0] and moon [1], recalculated once a day:
+static int time_to_y[24][2];
+static int y_at_rise[2], y_at_set[2], x_at_rise[2], x_at_set[2];
+static time_t rise_time[2], set_time[2];
+
+STATIC_ART(elev_axes,
+           SEG_LINE(128, 8, 128, 248),  // y-axis
+           SEG_LINE(8, 8, 248, 8));     // x-axis
+
+void build_elev_axes(int which_buffer, void *context)
 {
   int x, y;
-  static seg_or_flag axes[] = {
-      {128, 120, 0, 252, legacy_neg, 0x0ff}, // y-axis creates a line from 128,8 to 128,248
-      {128, 8, 240, 0, legacy_neg, 0x0ff},   // x-axis creates a line from 8,8 to 248,8
-      {255, 255, 0, 0, cir, 0x00},
-  };
-  // time_t today = midnightInTimeZone(now,global_prefs.prefs_data.utc_offset);
-  time_t today = midnightInTimeZone(now, my_location.gmt_offset);
-  static time_t last_calcs = 0;
-  time_t t;
-
-  static int time_to_y[24][2];
-  static int y_at_rise[2], y_at_set[2], x_at_rise[2], x_at_set[2];
-  static double rise_elev, set_elev;
-  static time_t rise_time[2], set_time[2];
 
-  // render axes:
-  clear_buffer(MAIN_BUFFER);
-  line(128, 8, 128, 248, MAIN_BUFFER);
-  line(8, 8, 248, 8, MAIN_BUFFER);
-  // compileSegments(axes,MAIN_BUFFER,OVERWRITE);
-  //line(0,8,255,8,MAIN_BUFFER);   // horiz axis
+  compileArt(&elev_axes, which_buffer, APPEND);
 
   for (x = 8; x <= 240; x += 10)
   { // horiz axis tick marks
-    line(x, 0, x, 16, MAIN_BUFFER);
+    line(x, 0, x, 16, which_buffer);
   }
 
   //line(128,0,128,240,MAIN_BUFFER);
   for (y = 18; y <= 248; y += 26)
   { // vertical axis tick marks
-    line(120, y + 8, 136, y + 8, MAIN_BUFFER);
+    line(120, y + 8, 136, y + 8, which_buffer);
   }
+}
+
+// inserts (x,y) into a curve kept sorted by x, ignoring events that fall off the chart:
+static void add_curve_point(vc_point *curve, int *n, float x, float y)
+{
+  int i = *n;
+
+  if (x < LEFT_MARGIN || x > RIGHT_MARGIN)
+    return;
+
+  while (i > 0 && curve[i - 1].x > x)
+  {
+    curve[i] = curve[i - 1];
+    i--;
+  }
+  curve[i].x = x;
+  curve[i].y = y;
+  (*n)++;
+}
+
+// labels, rise and set times, and the hourly elevation points.  context points to zeroForSunOneForMoon:
+void build_elev_chart(int which_buffer, void *context)
+{
+  int zeroForSunOneForMoon = *(int *)context;
+  int hour, y, i, n, run_start;
+  vc_point curve[26];
+  struct tm bdt;
+  char event_str[64];
+
+  if (zeroForSunOneForMoon == 0)
+  {
+    compileString("Sunrise", 16, 220, which_buffer, 1, APPEND);
+    compileString("Sunset", 154, 220, which_buffer, 1, APPEND);
+  }
+  else
+  {
+    compileString("Moonrise", 16, 220, which_buffer, 1, APPEND);
+    compileString("Moonset", 154, 220, which_buffer, 1, APPEND);
+  }
+
+  bdt = *gmtime(&rise_time[zeroForSunOneForMoon]);
+  strftime(event_str, sizeof(event_str), "%l:%M %p", &bdt);
+  compileString(event_str, 0, 190, which_buffer, 1, APPEND);
+  bdt = *gmtime(&set_time[zeroForSunOneForMoon]);
+  strftime(event_str, sizeof(event_str), "%l:%M %p", &bdt);
+  compileString(event_str, 138, 190, which_buffer, 1, APPEND);
+
+  // collect the hourly samples above the horizon, plus the rise and set points, in x order:
+  n = 0;
+  for (hour = 0; hour < 24; hour++)
+  {
+    y = time_to_y[hour][zeroForSunOneForMoon];
+    if (y > 0)
+    {
+      curve[n].x = 10 * hour + 8;
+      curve[n].y = y + 8;
+      n++;
+    }
+  }
+  add_curve_point(curve, &n, x_at_rise[zeroForSunOneForMoon], y_at_rise[zeroForSunOneForMoon] + 8);
+  add_curve_point(curve, &n, x_at_set[zeroForSunOneForMoon], y_at_set[zeroForSunOneForMoon] + 8);
+
+  // and draw each stretch of it that's above the horizon as a smooth curve:
+  for (i = 0, run_start = 0; i < n; i++)
+  {
+    if (i == n - 1 || curve[i + 1].x - curve[i].x > 10)
+    {
+      fit_polyline(&curve[run_start], i - run_start + 1, ELEV_CURVE_TOLERANCE, which_buffer);
+      run_start = i + 1;
+    }
+  }
+  circle(x_at_rise[zeroForSunOneForMoon], y_at_rise[zeroForSunOneForMoon] + 8, 8, which_buffer);
+  circle(x_at_set[zeroForSunOneForMoon], y_at_set[zeroForSunOneForMoon] + 8, 8, which_buffer);
+}
+
+void renderSunOrMoonElev(time_t now, struct tm *local_bdt, struct tm *utc_bdt, int zeroForSunOneForMoon)
+{
+  static retained_layer axes_layer = RETAINED_LAYER(build_elev_axes);
+  static retained_layer chart[2] = {RETAINED_LAYER(build_elev_chart), RETAINED_LAYER(build_elev_chart)};
+  // time_t today = midnightInTimeZone(now,global_prefs.prefs_data.utc_offset);
+  time_t today = midnightInTimeZone(now, my_location.gmt_offset);
+  static time_t last_calcs = 0;
+  time_t t;
+
+  static double rise_elev, set_elev;
+
+  // render axes:
+  clear_buffer(MAIN_BUFFER);
+  draw_layer(&axes_layer, 0, NULL, MAIN_BUFFER);
 
   // draw a dotted line denoting the current time:
   float day_fraction = local_bdt->tm_hour / 24.0 + local_bdt->tm_min / 1440.0;
@@ -1324,41 +1738,9 @@ void renderSunOrMoonElev(time_t now, struct tm *local_bdt, struct tm *utc_bdt, i
       last_calcs = today;
     }
   }
-  else
-  { // calcs have already been done for today.  Just use the cached values:
-    int hour;
-    struct tm bdt;
-    char event_str[64];
-
-    if (zeroForSunOneForMoon == 0)
-    {
-      compileString("Sunrise", 16, 220, MAIN_BUFFER, 1, APPEND);
-      compileString("Sunset", 154, 220, MAIN_BUFFER, 1, APPEND);
-    }
-    else
-    {
-      compileString("Moonrise", 16, 220, MAIN_BUFFER, 1, APPEND);
-      compileString("Moonset", 154, 220, MAIN_BUFFER, 1, APPEND);
-    }
-
-    bdt = *gmtime(&rise_time[zeroForSunOneForMoon]);
-    strftime(event_str, sizeof(event_str), "%l:%M %p", &bdt);
-    compileString(event_str, 0, 190, MAIN_BUFFER, 1, APPEND);
-    bdt = *gmtime(&set_time[zeroForSunOneForMoon]);
-    strftime(event_str, sizeof(event_str), "%l:%M %p", &bdt);
-    compileString(event_str, 138, 190, MAIN_BUFFER, 1, APPEND);
-
-    for (hour = 0; hour < 24; hour++)
-    {
-      y = time_to_y[hour][zeroForSunOneForMoon];
-      if (y > 0)
-      {
-        circle(10 * hour + 8, y + 8, 8, MAIN_BUFFER);
-      }
-    }
-    circle(x_at_rise[zeroForSunOneForMoon], y_at_rise[zeroForSunOneForMoon] + 8, 8, MAIN_BUFFER);
-    circle(x_at_set[zeroForSunOneForMoon], y_at_set[zeroForSunOneForMoon] + 8, 8, MAIN_BUFFER);
-  }
+  // the chart only needs rebuilding when the calcs are redone.  It's drawn on the frame they're done in too, since
+  // with the frame memo that frame may be on screen for a whole minute:
+  draw_layer(&chart[zeroForSunOneForMoon], last_calcs, &zeroForSunOneForMoon, MAIN_BUFFER);
 }
 
 // Sun elevation diagram, as inspired by SGITeach:
@@ -1393,19 +1775,14 @@ void renderSR2(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
   struct tm bdt;
   struct location my_location; // this will move to prefs and/or we'll get it from GPS
 
-  static seg_or_flag sun[] = {
-      {128, 0, SUN_SIZE, SUN_SIZE, cir, 0x0ff},
-      {255, 255, 0, 0, cir, 0x00},
-  };
+  STATIC_ART(sun, SEG_CIRCLE(128, 0, SUN_SIZE));
 
-  static seg_or_flag moon[] = {
-      {128, 0, 127, 127, cir, 0xff},
-      {144, 0, 38, 42, cir, 0xff},
-      {106, 10, 12, 14, cir, 0xff},
-      {114, 26, 14, 12, cir, 0xff},
-      {140, 38, 24, 20, cir, 0xff},
-      {255, 255, 0, 0, cir, 0x00},
-  };
+  STATIC_ART(moon,
+             SEG_CIRCLE(128, 0, 127),
+             SEG_ELLIPSE(144, 0, 38, 42, 0xff),
+             SEG_ELLIPSE(106, 10, 12, 14, 0xff),
+             SEG_ELLIPSE(114, 26, 14, 12, 0xff),
+             SEG_ELLIPSE(140, 38, 24, 20, 0xff));
 
   static unsigned long int next_animation_time = 0; // allows us to keep tracj and calc rises and sets once/day
   static int sun_y = 0;
@@ -1419,8 +1796,6 @@ void renderSR2(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
   // advance the animation if it's time:
   if (check_timer(&animation_step_timer))
   {
-    offsetSegments(sun, 0, animation_step);
-    offsetSegments(moon, 0, animation_step);
     reset_timer(&animation_step_timer);
     sun_y += animation_step;
     if (sun_y == animation_stop)
@@ -1439,31 +1814,28 @@ void renderSR2(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
   //insetSegments(sun,16,16);
   if (oneForSun == 1)
   {
-    float angle;
-    float outset = 0.6 * SUN_SIZE;
-    float outset2 = 0.9 * SUN_SIZE;
-    compileSegments(sun, MAIN_BUFFER, APPEND);
+    int ray;
+    vc_coord origin_x, origin_y, end_x, end_y;
+    push_transform();
+    translate_transform(0, sun_y);
+    transformArt(&sun, MAIN_BUFFER, APPEND);
+    pop_transform();
     // draw rays
 
-    for (angle = 0.0; angle < 2 * M_PI - 0.1; angle += 2 * M_PI / 12.0)
+    for (ray = 0; ray < 12; ray++)
     {
-      float origin_x = 128 + outset * cos(angle);
-      float origin_y = sun_y + outset * sin(angle);
-      float end_x = 128 + outset2 * cos(angle);
-      float end_y = sun_y + outset2 * sin(angle);
-
-      if (inBounds(origin_x, 0.0, 255.0) &&
-          inBounds(origin_y, 0.0, 255.0) &&
-          inBounds(end_x, 0.0, 255.0) &&
-          inBounds(end_y, 0.0, 255.0))
-      {
-        line(origin_x, origin_y, end_x, end_y, MAIN_BUFFER);
-      }
+      polar_fx(VC_FX(128), VC_FX(sun_y), VC_FX(0.6 * SUN_SIZE), ANGLE_PART(ray, 12), &origin_x, &origin_y);
+      polar_fx(VC_FX(128), VC_FX(sun_y), VC_FX(0.9 * SUN_SIZE), ANGLE_PART(ray, 12), &end_x, &end_y);
+
+      line_fx(origin_x, origin_y, end_x, end_y, MAIN_BUFFER);
     }
   }
   else
   { // draw moon features here:
-    compileSegments(moon, MAIN_BUFFER, APPEND);
+    push_transform();
+    translate_transform(0, sun_y);
+    transformArt(&moon, MAIN_BUFFER, APPEND);
+    pop_transform();
   }
   //time_t today = midnightInTimeZone(now,-8);
   time_t today = midnightInTimeZone(now, -8);
@@ -1573,17 +1945,15 @@ char poll_fifo()
   return buf[0];
 }
 
-vector_font test_pat3 = {
-    {128, 254, 8, 8, cir, 0xff},
-    {254, 128, 8, 8, cir, 0xff},
-    {128, 0, 8, 8, cir, 0xff},
-    {0, 128, 8, 8, cir, 0xff},
-    {128, 128, 254, 254, cir, 0xff},
-    {128, 128, 96, 96, cir, 0x55},
-    {128, 128, 0, 128, pos, 0xff},
-    {128, 128, 128, 0, pos, 0xff},
-
-    {.flag = 0xff}};
+STATIC_ART(test_pat3,
+           SEG_CIRCLE(128, 254, 8),
+           SEG_CIRCLE(254, 128, 8),
+           SEG_CIRCLE(128, 0, 8),
+           SEG_CIRCLE(0, 128, 8),
+           SEG_CIRCLE(128, 128, 254),
+           SEG_ELLIPSE(128, 128, 96, 96, 0x55),
+           SEG_SHAPE(128, 128, 0, 128, pos, 0xff),
+           SEG_SHAPE(128, 128, 128, 0, pos, 0xff));
 
 vector_font hw_test_pat = {
     {128, 128, 128, 128, 0x0f, 0xff},
@@ -1609,13 +1979,17 @@ int main(int argc, char *argv[])
   int opt;
   char *rpmsg_dev = "/dev/rpmsg0";
   bool no_curling = false; // don't call web services if this is true
+  bool reorder_segments = true; // reorder each frame to minimize beam travel unless this is false
+  bool try_remote_text = false;  // upload the font and send strings as text records, if the remote takes them
+  int requested_window = 1;      // messages in flight per frame, if the remote agrees to more than one
+  unsigned long render_start, render_us, transport_us = 0; // for the performance HUD
 
   curl_global_init(CURL_GLOBAL_DEFAULT);
 
   // settings stuff:
   //init_settings();
 
-  while ((opt = getopt(argc, argv, "d:n")) != -1)
+  while ((opt = getopt(argc, argv, "d:nb:sptw:v:")) != -1)
   {
     switch (opt)
     {
@@ -1627,6 +2001,30 @@ int main(int argc, char *argv[])
       no_curling = true;
       break;
 
+    case 's': // send segments in the order they were drawn
+      reorder_segments = false;
+      break;
+
+    case 't': // have the remote expand text from its own copy of the font
+      try_remote_text = true;
+      break;
+
+    case 'w': // send frames with up to this many messages in flight
+      requested_window = atoi(optarg);
+      break;
+
+    case 'p': // start with the performance HUD showing
+      show_hud = true;
+      break;
+
+    case 'v': // print statistics every so many seconds
+      stats_interval_us = atoi(optarg) * 1000000UL;
+      break;
+
+    case 'b': // time the segment transform kernels and exit
+      seg_kernels_benchmark(atoi(optarg));
+      return 0;
+
     default:
       printf("getopt return unsupported option: -%c\n", opt);
       break;
@@ -1644,8 +2042,8 @@ int main(int argc, char *argv[])
     return -1;
   }
 
-  i_payload = (struct _payload *)malloc(512);
-  r_payload = (struct _payload *)malloc(512);
+  i_payload = (struct _payload *)malloc(RPMSG_BUFFER_SIZE);
+  r_payload = (struct _payload *)malloc(RPMSG_BUFFER_SIZE);
 
   if (i_payload == 0 || r_payload == 0)
   {
@@ -1660,6 +2058,21 @@ int main(int argc, char *argv[])
     while (1)
       ;
   }
+  if (get_capabilities())
+    printf("remote protocol %d: %d byte messages, %d segments per list, features 0x%x\n", remote_caps.protocol_version,
+           max_data_length + RPMSG_HEADER_LENGTH, remote_caps.buffer_capacity, remote_caps.features);
+  else
+    printf("remote didn't report its capabilities; sending %d byte messages\n", max_data_length + RPMSG_HEADER_LENGTH);
+  // a remote that answered the handshake says what it takes; one that didn't may still, so it's asked:
+  bool caps_known = remote_caps.protocol_version > 0;
+  if (try_remote_text && (!caps_known || (remote_caps.features & REMOTE_FEATURE_TEXT)))
+  {
+    remote_text = upload_font();
+    printf("remote text %s\n", remote_text ? "enabled" : "not supported by the remote; expanding text here");
+  }
+  if (requested_window > 1 && (!caps_known || (remote_caps.features & REMOTE_FEATURE_WINDOW)))
+    printf("transfer window %d\n", negotiate_window(requested_window));
+
 #undef TEST_KNOB
 #ifdef TEST_KNOB
   printf("testing knob\n");
@@ -1672,9 +2085,6 @@ int main(int argc, char *argv[])
   }
 #endif
 
-  // initialize the system font:
-  init_font();
-
   struct timespec clock_resolution;
   int time0, time1;
   int stat;
@@ -1685,7 +2095,11 @@ int main(int argc, char *argv[])
          clock_resolution.tv_sec, clock_resolution.tv_nsec);
 
   int which_clock_face = 0;
+  int mode;
+  bool fresh_frame;
   init_flws();
+  show_layer(AUX_BUFFER, true);
+  show_layer(DEBUG_BUFFER, show_hud);
 
   // TEMPORARY:
   init_location(&my_location);
@@ -1746,6 +2160,15 @@ int main(int argc, char *argv[])
       }
       break;
 
+    case 'p': // toggle the performance HUD
+      show_hud = !show_hud;
+      show_layer(DEBUG_BUFFER, show_hud);
+      break;
+
+    case 'v': // print statistics
+      print_stats();
+      break;
+
     default:
       //which_clock_face = (microseconds() / 5000000) % 9;
       //which_clock_face = 3;
@@ -1757,96 +2180,150 @@ int main(int argc, char *argv[])
     which_clock_face += knob_motion();
     if (which_clock_face < 0)
       which_clock_face += nmodes;
-    switch (which_clock_face % nmodes)
-#else
-    switch (which_clock_face % nmodes)
 #endif
+    mode = which_clock_face % nmodes;
+    fresh_frame = !frame_memo_lookup(&mode_memos[mode], mode, now, location_key(&my_location));
 
+    render_start = microseconds();
+    if (fresh_frame)
     {
+      switch (mode)
+      {
 
-    case 0:
-      renderAnalogClockBuffer(now, &local_bdt, &utc_bdt);
-      //render_single_circle();
-      break;
-
-    case 1:
-      render_lissajou_buffer(now, &local_bdt, &utc_bdt);
-      break;
-
-    case 2:
-      //render_characters_buffer(now,&local_bdt,&utc_bdt);
-      render_ip_address();
-      break;
-
-    case 3:
-      render_pendulum_buffer(now, &local_bdt, &utc_bdt);
-      break;
-
-    case 4:
-      compileSegments(test_pat3, MAIN_BUFFER, OVERWRITE);
-      update_screen_saver(0, 0); // no screensaver offset for calibration screen
-      break;
-
-    case 5:
-      //render_fine_circles();
-      render_flw(now, &local_bdt, &utc_bdt);
-      break;
-
-    case 6:
-      pong_update();
-      render_pong_buffer(game_state, now, &local_bdt, &utc_bdt);
-      break;
-
-    case 7:
-      render_word_clock(now, &local_bdt, &utc_bdt);
-      break;
-
-    case 8:
-      //render_menagerie(now, &local_bdt, &utc_bdt);
-      renderSunElev(now, &local_bdt, &utc_bdt);
-      break;
-
-    case 9:
-      display_mode = moonriseMode;
-      renderMoonElev(now, &local_bdt, &utc_bdt);
-      break;
-
-    case 10:
-      display_mode = sunriseMode;
-      renderSR2(now, &local_bdt, &utc_bdt);
-      break;
-
-    case 11:
-      display_mode = moonriseMode;
-      renderSR2(now, &local_bdt, &utc_bdt);
-      break;
+      case 0:
+        renderAnalogClockBuffer(now, &local_bdt, &utc_bdt);
+        //render_single_circle();
+        break;
+
+      case 1:
+        render_lissajou_buffer(now, &local_bdt, &utc_bdt);
+        break;
+
+      case 2:
+        //render_characters_buffer(now,&local_bdt,&utc_bdt);
+        render_ip_address();
+        break;
+
+      case 3:
+        render_pendulum_buffer(now, &local_bdt, &utc_bdt);
+        break;
+
+      case 4:
+        compileArt(&test_pat3, MAIN_BUFFER, OVERWRITE);
+        break;
+
+      case 5:
+        //render_fine_circles();
+        render_flw(now, &local_bdt, &utc_bdt);
+        break;
+
+      case 6:
+        pong_update();
+        render_pong_buffer(game_state, now, &local_bdt, &utc_bdt);
+        break;
+
+      case 7:
+        render_word_clock(now, &local_bdt, &utc_bdt);
+        break;
+
+      case 8:
+        //render_menagerie(now, &local_bdt, &utc_bdt);
+        renderSunElev(now, &local_bdt, &utc_bdt);
+        break;
+
+      case 9:
+        display_mode = moonriseMode;
+        renderMoonElev(now, &local_bdt, &utc_bdt);
+        break;
+
+      case 10:
+        display_mode = sunriseMode;
+        renderSR2(now, &local_bdt, &utc_bdt);
+        break;
+
+      case 11:
+        display_mode = moonriseMode;
+        renderSR2(now, &local_bdt, &utc_bdt);
+        break;
+
+      case 12:
+        render_BTC_price();
+        break;
+
+      case 13:
+        render_text_clock(now, &local_bdt, &utc_bdt);
+        break;
+
+      case 14:
+        render_current_weather(now, &local_bdt, &utc_bdt);
+        break;
+
+      case 15:
+        render_menagerie(now, &local_bdt, &utc_bdt);
+        break;
+      }
+    }
 
+    // scrolling text moves every frame, so it's drawn on its own layer while the memoized main frame stays put:
+    switch (mode)
+    {
     case 12:
-      render_BTC_price();
-      break;
-
-    case 13:
-      render_text_clock(now, &local_bdt, &utc_bdt);
+      animate_BTC_price(millis());
       break;
 
     case 14:
-      render_current_weather(now, &local_bdt, &utc_bdt);
+      animate_current_weather(millis());
       break;
 
-    case 15:
-      render_menagerie(now, &local_bdt, &utc_bdt);
+    default:
+      clear_buffer(AUX_BUFFER);
       break;
     }
+    render_us = microseconds() - render_start;
 
-    if (which_clock_face % nmodes != 4)
+    if (mode != 4)
       update_screen_saver(local_bdt.tm_min % 5, (local_bdt.tm_min - 2) % 4);
+    else
+      update_screen_saver(0, 0); // no screensaver offset for calibration screen
 
+    if (fresh_frame)
+    {
+      render_start = microseconds();
 #ifdef HW_TEST
-    render_hw_test_pattern();
+      render_hw_test_pattern();
 #endif
 
+      optimize_display_list(&display_lists[MAIN_BUFFER]); // drop, dedupe and merge segments before they cost us bandwidth
+      if (reorder_segments)
+        reorder_display_list(&display_lists[MAIN_BUFFER]); // and cut down the blanked beam travel between them
+      render_us += microseconds() - render_start;
+    }
+    else
+      render_us = 0;
+
+    if (show_hud)
+      render_perf_hud(render_us, transport_us); // transport time is the previous frame's
+
+    // copy the layers that changed to the remote processor, which will do the actual drawing.  A reused main frame
+    // is already there, unless the window was missed when it was new:
+    transport_us = 0;
     if (sync_window())
-      copy_seg_buffer(MAIN_BUFFER); // copy the display list to the remote processor, which will do the actual drawing
+    {
+      for (int i = 0; i < N_COMPOSITE_LAYERS; i++)
+      {
+        int layer = composite_order[i];
+
+        if (layer == MAIN_BUFFER && !frame_memo_needs_send())
+          continue;
+        if (layer_needs_send(layer))
+        {
+          transport_us += copy_seg_buffer(layer);
+          layer_sent(layer);
+        }
+        if (layer == MAIN_BUFFER)
+          frame_memo_sent();
+      }
+    }
 
   foo:
 
@@ -1862,6 +2339,11 @@ int main(int argc, char *argv[])
       printf("button = %d\n", get_button());
       next_fps_check = microseconds() + 2000000;
     }
+    if (stats_interval_us && microseconds() > next_stats_report)
+    {
+      print_stats();
+      next_stats_report = microseconds() + stats_interval_us;
+    }
   }
   //send_done();
 
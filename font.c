@@ -17,7 +17,11 @@
 
 #include "font.h"
 
-seg_or_flag *system_font[128];
+#ifdef FONT_ATLAS_GEN
+// The glyph definitions.  These are the source for font_atlas.h, which is what actually gets compiled in; after
+// changing any of them, rebuild the atlas with
+//   cc -DFONT_ATLAS_GEN -o font_atlas_gen font.c && ./font_atlas_gen > font_atlas.h
+#include <stdio.h>
 
 vector_font SpaceChar={
 {.flag=0x86},
@@ -780,117 +784,202 @@ vector_font Test_Pat = {
 {0,0, 255,255,cir,0xff},
 {.flag=0x84}
 };
-void init_font(){
-    system_font[0] = (seg_or_flag*)&SpaceChar;
-    system_font[1] = (seg_or_flag*)&Exclam;
-    system_font[2] = (seg_or_flag*)&DQuot;
-    system_font[3] = (seg_or_flag*)&Sharp;
-    system_font[4] = (seg_or_flag*)&Dollar;
-    system_font[5] = (seg_or_flag*)&Percent;
-    system_font[6] = (seg_or_flag*)&Amper;
-    system_font[7] = (seg_or_flag*)&Apost;
-    system_font[8] = (seg_or_flag*)&LParen;
-    system_font[9] = (seg_or_flag*)&RParen;
-    system_font[10] = (seg_or_flag*)&Aster;
-    system_font[11] = (seg_or_flag*)&Plus;
-    system_font[12] = (seg_or_flag*)&Comma;
-    system_font[13] = (seg_or_flag*)&Minus;
-    system_font[14] = (seg_or_flag*)&Period;
-    system_font[15] = (seg_or_flag*)&Slash;
-    system_font[16] = (seg_or_flag*)&Zero;
-    system_font[17] = (seg_or_flag*)&One;
-    system_font[18] = (seg_or_flag*)&Two;
-    system_font[19] = (seg_or_flag*)&Three;
-    system_font[20] = (seg_or_flag*)&Four;
-    system_font[21] = (seg_or_flag*)&Five;
-    system_font[22] = (seg_or_flag*)&Six;
-    system_font[23] = (seg_or_flag*)&Seven;
-    system_font[24] = (seg_or_flag*)&Eight;
-    system_font[25] = (seg_or_flag*)&Nine;
-    system_font[26] = (seg_or_flag*)&Colon;
-    system_font[27] = (seg_or_flag*)&SemiCol;
-    system_font[28] = (seg_or_flag*)&LThan;
-    system_font[29] = (seg_or_flag*)&Equal;
-    system_font[30] = (seg_or_flag*)&GThan;
-    system_font[31] = (seg_or_flag*)&Quest;
-    system_font[32] = (seg_or_flag*)&AtSign;
-    system_font[33] = (seg_or_flag*)&BigA;
-    system_font[34] = (seg_or_flag*)&BigB;
-    system_font[35] = (seg_or_flag*)&BigC;
-    system_font[36] = (seg_or_flag*)&BigD;
-    system_font[37] = (seg_or_flag*)&BigE;
-    system_font[38] = (seg_or_flag*)&BigF;
-    system_font[39] = (seg_or_flag*)&BigG;
-    system_font[40] = (seg_or_flag*)&BigH;
-    system_font[41] = (seg_or_flag*)&BigI;
-    system_font[42] = (seg_or_flag*)&BigJ;
-    system_font[43] = (seg_or_flag*)&BigK;
-    system_font[44] = (seg_or_flag*)&BigL;
-    system_font[45] = (seg_or_flag*)&BigM;
-    system_font[46] = (seg_or_flag*)&BigN;
-    system_font[47] = (seg_or_flag*)&BigO;
-    system_font[48] = (seg_or_flag*)&BigP;
-    system_font[49] = (seg_or_flag*)&BigQ;
-    system_font[50] = (seg_or_flag*)&BigR;
-    system_font[51] = (seg_or_flag*)&BigS;
-    system_font[52] = (seg_or_flag*)&BigT;
-    system_font[53] = (seg_or_flag*)&BigU;
-    system_font[54] = (seg_or_flag*)&BigV;
-    system_font[55] = (seg_or_flag*)&BigW;
-    system_font[56] = (seg_or_flag*)&BigX;
-    system_font[57] = (seg_or_flag*)&BigY;
-    system_font[58] = (seg_or_flag*)&BigZ;
-    system_font[59] = (seg_or_flag*)&LftSqBr;
-    system_font[60] = (seg_or_flag*)&BackSl;
-    system_font[61] = (seg_or_flag*)&RtSqBr;
-    system_font[62] = (seg_or_flag*)&Carat;
-    system_font[63] = (seg_or_flag*)&UnderSc;
-    system_font[64] = (seg_or_flag*)&BackQu;
-    system_font[65] = (seg_or_flag*)&SmallA;
-    system_font[66] = (seg_or_flag*)&SmallB;
-    system_font[67] = (seg_or_flag*)&SmallC;
-    system_font[68] = (seg_or_flag*)&SmallD;
-    system_font[69] = (seg_or_flag*)&SmallE;
-    system_font[70] = (seg_or_flag*)&SmallF;
-    system_font[71] = (seg_or_flag*)&SmallG;
-    system_font[72] = (seg_or_flag*)&SmallH;
-    system_font[73] = (seg_or_flag*)&SmallI;
-    system_font[74] = (seg_or_flag*)&SmallJ;
-    system_font[75] = (seg_or_flag*)&SmallK;
-    system_font[76] = (seg_or_flag*)&SmallL;
-    system_font[77] = (seg_or_flag*)&SmallM;
-    system_font[78] = (seg_or_flag*)&SmallN;
-    system_font[79] = (seg_or_flag*)&SmallO;
-    system_font[80] = (seg_or_flag*)&SmallP;
-    system_font[81] = (seg_or_flag*)&SmallQ;
-    system_font[82] = (seg_or_flag*)&SmallR;
-    system_font[83] = (seg_or_flag*)&SmallS;
-    system_font[84] = (seg_or_flag*)&SmallT;
-    system_font[85] = (seg_or_flag*)&SmallU;
-    system_font[86] = (seg_or_flag*)&SmallV;
-    system_font[87] = (seg_or_flag*)&SmallW;
-    system_font[88] = (seg_or_flag*)&SmallX;
-    system_font[89] = (seg_or_flag*)&SmallY;
-    system_font[90] = (seg_or_flag*)&SmallZ;
-    system_font[91] = (seg_or_flag*)&LfBrace;
-    system_font[92] = (seg_or_flag*)&VertBar;
-    system_font[93] = (seg_or_flag*)&RtBrace;
-    system_font[94] = (seg_or_flag*)&Tilde;
-    system_font[95] = (seg_or_flag*)&Rubout;
-    system_font[96] = (seg_or_flag*)&JDay;
-    system_font[97] = (seg_or_flag*)&JSun;
-    system_font[98] = (seg_or_flag*)&JMon;
-    system_font[99] = (seg_or_flag*)&JTue;
-    system_font[100] = (seg_or_flag*)&JWed;
-    system_font[101] = (seg_or_flag*)&JThu;
-    system_font[102] = (seg_or_flag*)&JFri;
-    system_font[103] = (seg_or_flag*)&JSat;
-    system_font[104] = (seg_or_flag*)&JYear;
-    system_font[105] = (seg_or_flag*)&JTEST;
-    system_font[106] = (seg_or_flag*)&BtcB;
-    system_font[107] = (seg_or_flag*)&Deg;
+static seg_or_flag *source_glyphs[FONT_GLYPHS];
+
+static void wire_glyphs(void){
+    source_glyphs[0] = (seg_or_flag*)&SpaceChar;
+    source_glyphs[1] = (seg_or_flag*)&Exclam;
+    source_glyphs[2] = (seg_or_flag*)&DQuot;
+    source_glyphs[3] = (seg_or_flag*)&Sharp;
+    source_glyphs[4] = (seg_or_flag*)&Dollar;
+    source_glyphs[5] = (seg_or_flag*)&Percent;
+    source_glyphs[6] = (seg_or_flag*)&Amper;
+    source_glyphs[7] = (seg_or_flag*)&Apost;
+    source_glyphs[8] = (seg_or_flag*)&LParen;
+    source_glyphs[9] = (seg_or_flag*)&RParen;
+    source_glyphs[10] = (seg_or_flag*)&Aster;
+    source_glyphs[11] = (seg_or_flag*)&Plus;
+    source_glyphs[12] = (seg_or_flag*)&Comma;
+    source_glyphs[13] = (seg_or_flag*)&Minus;
+    source_glyphs[14] = (seg_or_flag*)&Period;
+    source_glyphs[15] = (seg_or_flag*)&Slash;
+    source_glyphs[16] = (seg_or_flag*)&Zero;
+    source_glyphs[17] = (seg_or_flag*)&One;
+    source_glyphs[18] = (seg_or_flag*)&Two;
+    source_glyphs[19] = (seg_or_flag*)&Three;
+    source_glyphs[20] = (seg_or_flag*)&Four;
+    source_glyphs[21] = (seg_or_flag*)&Five;
+    source_glyphs[22] = (seg_or_flag*)&Six;
+    source_glyphs[23] = (seg_or_flag*)&Seven;
+    source_glyphs[24] = (seg_or_flag*)&Eight;
+    source_glyphs[25] = (seg_or_flag*)&Nine;
+    source_glyphs[26] = (seg_or_flag*)&Colon;
+    source_glyphs[27] = (seg_or_flag*)&SemiCol;
+    source_glyphs[28] = (seg_or_flag*)&LThan;
+    source_glyphs[29] = (seg_or_flag*)&Equal;
+    source_glyphs[30] = (seg_or_flag*)&GThan;
+    source_glyphs[31] = (seg_or_flag*)&Quest;
+    source_glyphs[32] = (seg_or_flag*)&AtSign;
+    source_glyphs[33] = (seg_or_flag*)&BigA;
+    source_glyphs[34] = (seg_or_flag*)&BigB;
+    source_glyphs[35] = (seg_or_flag*)&BigC;
+    source_glyphs[36] = (seg_or_flag*)&BigD;
+    source_glyphs[37] = (seg_or_flag*)&BigE;
+    source_glyphs[38] = (seg_or_flag*)&BigF;
+    source_glyphs[39] = (seg_or_flag*)&BigG;
+    source_glyphs[40] = (seg_or_flag*)&BigH;
+    source_glyphs[41] = (seg_or_flag*)&BigI;
+    source_glyphs[42] = (seg_or_flag*)&BigJ;
+    source_glyphs[43] = (seg_or_flag*)&BigK;
+    source_glyphs[44] = (seg_or_flag*)&BigL;
+    source_glyphs[45] = (seg_or_flag*)&BigM;
+    source_glyphs[46] = (seg_or_flag*)&BigN;
+    source_glyphs[47] = (seg_or_flag*)&BigO;
+    source_glyphs[48] = (seg_or_flag*)&BigP;
+    source_glyphs[49] = (seg_or_flag*)&BigQ;
+    source_glyphs[50] = (seg_or_flag*)&BigR;
+    source_glyphs[51] = (seg_or_flag*)&BigS;
+    source_glyphs[52] = (seg_or_flag*)&BigT;
+    source_glyphs[53] = (seg_or_flag*)&BigU;
+    source_glyphs[54] = (seg_or_flag*)&BigV;
+    source_glyphs[55] = (seg_or_flag*)&BigW;
+    source_glyphs[56] = (seg_or_flag*)&BigX;
+    source_glyphs[57] = (seg_or_flag*)&BigY;
+    source_glyphs[58] = (seg_or_flag*)&BigZ;
+    source_glyphs[59] = (seg_or_flag*)&LftSqBr;
+    source_glyphs[60] = (seg_or_flag*)&BackSl;
+    source_glyphs[61] = (seg_or_flag*)&RtSqBr;
+    source_glyphs[62] = (seg_or_flag*)&Carat;
+    source_glyphs[63] = (seg_or_flag*)&UnderSc;
+    source_glyphs[64] = (seg_or_flag*)&BackQu;
+    source_glyphs[65] = (seg_or_flag*)&SmallA;
+    source_glyphs[66] = (seg_or_flag*)&SmallB;
+    source_glyphs[67] = (seg_or_flag*)&SmallC;
+    source_glyphs[68] = (seg_or_flag*)&SmallD;
+    source_glyphs[69] = (seg_or_flag*)&SmallE;
+    source_glyphs[70] = (seg_or_flag*)&SmallF;
+    source_glyphs[71] = (seg_or_flag*)&SmallG;
+    source_glyphs[72] = (seg_or_flag*)&SmallH;
+    source_glyphs[73] = (seg_or_flag*)&SmallI;
+    source_glyphs[74] = (seg_or_flag*)&SmallJ;
+    source_glyphs[75] = (seg_or_flag*)&SmallK;
+    source_glyphs[76] = (seg_or_flag*)&SmallL;
+    source_glyphs[77] = (seg_or_flag*)&SmallM;
+    source_glyphs[78] = (seg_or_flag*)&SmallN;
+    source_glyphs[79] = (seg_or_flag*)&SmallO;
+    source_glyphs[80] = (seg_or_flag*)&SmallP;
+    source_glyphs[81] = (seg_or_flag*)&SmallQ;
+    source_glyphs[82] = (seg_or_flag*)&SmallR;
+    source_glyphs[83] = (seg_or_flag*)&SmallS;
+    source_glyphs[84] = (seg_or_flag*)&SmallT;
+    source_glyphs[85] = (seg_or_flag*)&SmallU;
+    source_glyphs[86] = (seg_or_flag*)&SmallV;
+    source_glyphs[87] = (seg_or_flag*)&SmallW;
+    source_glyphs[88] = (seg_or_flag*)&SmallX;
+    source_glyphs[89] = (seg_or_flag*)&SmallY;
+    source_glyphs[90] = (seg_or_flag*)&SmallZ;
+    source_glyphs[91] = (seg_or_flag*)&LfBrace;
+    source_glyphs[92] = (seg_or_flag*)&VertBar;
+    source_glyphs[93] = (seg_or_flag*)&RtBrace;
+    source_glyphs[94] = (seg_or_flag*)&Tilde;
+    source_glyphs[95] = (seg_or_flag*)&Rubout;
+    source_glyphs[96] = (seg_or_flag*)&JDay;
+    source_glyphs[97] = (seg_or_flag*)&JSun;
+    source_glyphs[98] = (seg_or_flag*)&JMon;
+    source_glyphs[99] = (seg_or_flag*)&JTue;
+    source_glyphs[100] = (seg_or_flag*)&JWed;
+    source_glyphs[101] = (seg_or_flag*)&JThu;
+    source_glyphs[102] = (seg_or_flag*)&JFri;
+    source_glyphs[103] = (seg_or_flag*)&JSat;
+    source_glyphs[104] = (seg_or_flag*)&JYear;
+    source_glyphs[105] = (seg_or_flag*)&JTEST;
+    source_glyphs[106] = (seg_or_flag*)&BtcB;
+    source_glyphs[107] = (seg_or_flag*)&Deg;
+
+}
+
+// the kerning rules that go into system_metrics, by scale:
+static const uint8 kerning_by_scale[KERNING_SCALES] = {4, 4, 4, 3, 4, 5};
+#define SHORT_STRING_LENGTH 6
+#define SHORT_STRING_EXTRA 2
+
+static void print_char_comment(int code){
+  if(code > ' ' && code < 127 && code != '\\')
+    printf("   // '%c'\n", code);
+  else
+    printf("   // 0x%02x\n", code);
+}
+
+int main(){
+  static const char *shape_names[] = {"cir", "legacy_pos", "legacy_neg", "pos", "neg", "lissajou0", "lissajou1",
+                                      "lissajou2", "lissajou3", "lissajou4", "lissajou5"};
+  int offsets[FONT_GLYPHS], n_segs[FONT_GLYPHS], widths[FONT_GLYPHS];
+  int i, k, length = 0;
+
+  wire_glyphs();
+  printf("/*\n"
+         "\n"
+         " Copyright (C) 2016-2021 Michael Boich\n"
+         "\n"
+         " This program is free software: you can redistribute it and/or modify\n"
+         " it under the terms of the GNU General Public License as published by\n"
+         " the Free Software Foundation, either version 3 of the License, or\n"
+         " (at your option) any later version.\n"
+         "\n"
+         " This program is distributed in the hope that it will be useful,\n"
+         " but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+         " MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+         " GNU General Public License for more details.\n"
+         "\n"
+         " Generated by font_atlas_gen from the glyph definitions in font.c.  Don't edit this; rebuild it with\n"
+         "   cc -DFONT_ATLAS_GEN -o font_atlas_gen font.c && ./font_atlas_gen > font_atlas.h\n"
+         "*/\n\n");
+  printf("const seg_or_flag font_atlas[] = {\n");
+  for(i = 0; i < FONT_GLYPHS; i++){
+    seg_or_flag *seg_ptr = source_glyphs[i];
+
+    offsets[i] = FONT_NO_GLYPH;
+    n_segs[i] = widths[i] = 0;
+    if(seg_ptr == NULL) continue;
+    printf("\n");
+    offsets[i] = length;
+    for(k = 0; seg_ptr[k].seg_data.x_offset < 0x80; k++){
+      vc_segment *seg = &seg_ptr[k].seg_data;
+
+      printf("    {{%d, %d, %d, %d, %s, 0x%02x}},", seg->x_offset, seg->y_offset, seg->x_size, seg->y_size,
+             shape_names[seg->arc_type], seg->mask);
+      if(k == 0) print_char_comment(i + 32);
+      else printf("\n");
+    }
+    printf("    {.flag = 0x%02x},", seg_ptr[k].flag);
+    if(k == 0) print_char_comment(i + 32);
+    else printf("\n");
+    n_segs[i] = k;
+    widths[i] = seg_ptr[k].flag & 0x7f;   // end flag - 0x80 + char width
+    length += k + 1;
+  }
+  printf("};\n\nconst int font_atlas_length = %d;\n\n", length);
+
+  printf("const font_metrics system_metrics = {\n  .glyphs = {\n");
+  for(i = 0; i < FONT_GLYPHS; i++){
+    printf("    {%d, %d, %d},", offsets[i], widths[i], n_segs[i]);
+    print_char_comment(i + 32);
+  }
+  printf("  },\n  .kerning = {");
+  for(i = 0; i < KERNING_SCALES; i++)
+    printf(i ? ", %d" : "%d", kerning_by_scale[i]);
+  printf("},\n  .short_length = %d,\n  .short_extra = %d,\n};\n", SHORT_STRING_LENGTH, SHORT_STRING_EXTRA);
+  return 0;
 }
 
+#else
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "font_atlas.h"
+
 // pins integer values to uint8 range, rather than letting them wrap around:
 uint8 pin(int x){
   if(x<0)x=0;
@@ -898,20 +987,172 @@ uint8 pin(int x){
   return x;
 }
 
-// returns the width of a single vector character:
-int char_width(char c){
-  seg_or_flag *seg_ptr = system_font[((uint8) c)-32];    // map from char code to segment list
-  while(seg_ptr->seg_data.x_offset<0x80) seg_ptr++;       // skip over segments
-  return seg_ptr->flag & 0x7f;                 // end flag - 0x80 + char width
+// the system font's glyph for a code point, or -1:
+static int system_glyph_id(uint32_t codepoint){
+  int id;
+
+  if(codepoint == 0xb0) codepoint = 0x8b;         // degree sign
+  else if(codepoint == 0x20bf) codepoint = 0x8a;  // bitcoin sign
+  id = codepoint - 32;
+  if(codepoint < 32 || id >= FONT_GLYPHS || system_metrics.glyphs[id].offset == FONT_NO_GLYPH) return -1;
+  return id;
+}
+
+vc_font system_font;
+static vc_font *font_in_use = &system_font;
+
+void set_font(vc_font *font){
+  font_in_use = font ? font : &system_font;
+}
+vc_font *current_font(void){
+  return font_in_use;
+}
+
+int font_glyph(vc_font *font, uint32_t codepoint, glyph_ref *glyph){
+  int id;
+
+  if(font->header == NULL){
+    if((id = system_glyph_id(codepoint)) < 0) return 0;
+    glyph->segs = font_atlas + system_metrics.glyphs[id].offset;
+    glyph->width = system_metrics.glyphs[id].width;
+    glyph->n_segs = system_metrics.glyphs[id].n_segs;
+  }
+  else{
+    const vcf_glyph *entry;
+    int slot = codepoint % FONT_CACHE_ENTRIES;
+
+    font->lookups++;
+    if(font->cache[slot].codepoint == codepoint)
+      id = font->cache[slot].id;
+    else{
+      // binary search of the index, which is sorted by code point:
+      int lo = 0, hi = font->header->n_glyphs - 1;
+
+      font->cache_misses++;
+      id = -1;
+      while(lo <= hi){
+        int mid = (lo + hi) / 2;
+
+        if(font->glyphs[mid].codepoint == codepoint){
+          id = mid;
+          break;
+        }
+        if(font->glyphs[mid].codepoint < codepoint) lo = mid + 1;
+        else hi = mid - 1;
+      }
+      font->cache[slot].codepoint = codepoint;
+      font->cache[slot].id = id;
+    }
+    if(id < 0) return 0;
+    entry = &font->glyphs[id];
+    // the header was checked when the font was loaded; each entry is checked as it's used:
+    // (written so nothing can wrap: the glyph's segments plus its end flag must fit inside the atlas)
+    if(entry->offset >= font->header->n_segs || entry->n_segs >= font->header->n_segs - entry->offset) return 0;
+    glyph->segs = font->atlas + entry->offset;
+    glyph->width = entry->width;
+    glyph->n_segs = entry->n_segs;
+  }
+  glyph->id = id;
+  return 1;
+}
+
+vc_font *load_font(const char *path){
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  const vcf_header *header;
+  vc_font *font;
+  void *mapping;
+  int i;
+
+  if(fd < 0) return NULL;
+  if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(vcf_header)){
+    close(fd);
+    return NULL;
+  }
+  mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);    // the mapping stays good without it
+  if(mapping == MAP_FAILED) return NULL;
+
+  header = mapping;
+  if(memcmp(header->magic, "VCFN", 4) || header->version != VCF_VERSION ||
+     sizeof(vcf_header) + (uint64_t)header->n_glyphs * sizeof(vcf_glyph) + (uint64_t)header->n_segs * sizeof(seg_or_flag) >
+     (uint64_t)st.st_size || !(font = calloc(1, sizeof(vc_font)))){
+    munmap(mapping, st.st_size);
+    return NULL;
+  }
+  font->header = header;
+  font->glyphs = (const vcf_glyph *)(header + 1);
+  font->atlas = (const seg_or_flag *)(font->glyphs + header->n_glyphs);
+  font->mapping_size = st.st_size;
+  for(i = 0; i < FONT_CACHE_ENTRIES; i++)
+    font->cache[i].codepoint = UINT32_MAX;    // matches nothing
+  return font;
+}
+
+void unload_font(vc_font *font){
+  if(font == NULL || font == &system_font) return;
+  if(font_in_use == font) font_in_use = &system_font;
+  munmap((void *)font->header, font->mapping_size);
+  free(font);
+}
+
+uint32_t utf8_next(const char **s, const char *end){
+  const uint8 *p = (const uint8 *)*s;
+  uint32_t codepoint;
+  int n, i;
+
+  if(p[0] < 0x80) n = 0, codepoint = p[0];
+  else if((p[0] & 0xe0) == 0xc0) n = 1, codepoint = p[0] & 0x1f;
+  else if((p[0] & 0xf0) == 0xe0) n = 2, codepoint = p[0] & 0x0f;
+  else if((p[0] & 0xf8) == 0xf0) n = 3, codepoint = p[0] & 0x07;
+  else n = -1, codepoint = 0;
+
+  for(i = 1; i <= n; i++){
+    if((const char *)p + i >= end || (p[i] & 0xc0) != 0x80) break;
+    codepoint = (codepoint << 6) | (p[i] & 0x3f);
+  }
+  // anything malformed, or overlong, is taken a byte at a time:
+  if(n < 0 || i <= n || (n == 1 && codepoint < 0x80) || (n == 2 && codepoint < 0x800) || (n == 3 && codepoint < 0x10000)){
+    *s += 1;
+    return p[0];
+  }
+  *s += n + 1;
+  return codepoint;
+}
+
+int utf8_length(const char *s, int len){
+  const char *end = s + len;
+  int n = 0;
+
+  while(s < end){
+    utf8_next(&s, end);
+    n++;
+  }
+  return n;
+}
+
+// the space compileString leaves between the characters of a string len characters long, in the current font:
+int font_kerning(uint8 scale, int len){
+  const vcf_header *header = font_in_use->header;
+  int index = scale < KERNING_SCALES ? scale : KERNING_SCALES - 2;   // scale 5's extra space doesn't carry upward
+  int kerning = header ? header->kerning[index] : system_metrics.kerning[index];
+
+  if(len < (header ? header->short_length : system_metrics.short_length))
+    kerning += header ? header->short_extra : system_metrics.short_extra;
+  return kerning;
 }
 
-// returns the width (sum of character widths) of a string:
-uint8 stringWidth(char s[],uint8 scale){
-  int width=0,index=0;
+// returns the width (sum of character widths) of the first len bytes of s, in the current font:
+uint8 stringWidth(const char *s, int len, uint8 scale){
+  const char *end = s + len;
+  int width=0;
+  glyph_ref glyph;
 
-  while(*s){
-    width += char_width(*s);
-    s++;
+  while(s < end){
+    if(font_glyph(font_in_use, utf8_next(&s, end), &glyph))
+      width += glyph.width;
   }
   return pin(width*scale);
 }
+
+#endif
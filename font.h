@@ -20,6 +20,7 @@
 */
 
 #include <string.h> 
+#include <stdint.h>
 
 #ifndef font_h 
 #define font_h
@@ -66,12 +67,92 @@ typedef seg_or_flag vector_font[];
 
 //const int kerning=4;
 
-extern seg_or_flag *system_font[128];
+// The system font is one packed, read-only atlas generated from the glyph definitions in font.c (see font_atlas.h):
+// every glyph's segments and end flag, back to back, found through its entry in system_metrics.  Nothing needs
+// initializing at run time.  Glyphs are indexed by character code - 32:
+#define FONT_GLYPHS 128
+#define FONT_NO_GLYPH 0xffff
+#define KERNING_SCALES 6    // larger scales use scale 4's entry
+
+typedef struct {
+  uint16_t offset;  // of the glyph's first segment in font_atlas, or FONT_NO_GLYPH
+  uint8 width;      // at scale 1, from the glyph's end flag
+  uint8 n_segs;
+} glyph_metrics;
+
+typedef struct {
+  glyph_metrics glyphs[FONT_GLYPHS];
+  uint8 kerning[KERNING_SCALES];  // space between characters, by scale
+  uint8 short_length;             // strings shorter than this
+  uint8 short_extra;              // get this much more, so short labels don't look cramped
+} font_metrics;
+
+extern const seg_or_flag font_atlas[];
+extern const int font_atlas_length;     // in segments, end flags included
+extern const font_metrics system_metrics;
+
+// Loadable fonts.  A .vcf file is a vcf_header, then n_glyphs vcf_glyph entries sorted by code point, then the
+// atlas: n_segs segments and end flags, each glyph's back to back as in font_atlas.  Files are mapped and used in
+// place, and loading only checks the header, so it costs the same whatever the size of the font:
+#define VCF_VERSION 1
+
+typedef struct {
+  char magic[4];            // "VCFN"
+  uint8 version;
+  uint8 short_length, short_extra;
+  uint8 reserved;
+  uint8 kerning[KERNING_SCALES];
+  uint16_t reserved2;
+  uint32_t n_glyphs;
+  uint32_t n_segs;
+} vcf_header;
+
+typedef struct {
+  uint32_t codepoint;
+  uint32_t offset;          // of the glyph's first segment in the atlas
+  uint8 width;
+  uint8 n_segs;
+  uint16_t reserved;
+} vcf_glyph;
+
+// what a glyph lookup finds.  id is the glyph's place in its font:
+typedef struct {
+  const seg_or_flag *segs;
+  int width, n_segs, id;
+} glyph_ref;
+
+#define FONT_CACHE_ENTRIES 64
+
+typedef struct {
+  const vcf_header *header;   // NULL for the system font
+  const vcf_glyph *glyphs;
+  const seg_or_flag *atlas;
+  size_t mapping_size;
+  struct {
+    uint32_t codepoint;
+    int id;                   // -1 if the font has no such glyph
+  } cache[FONT_CACHE_ENTRIES]; // recent lookups, direct mapped by code point
+  unsigned long lookups, cache_misses;
+} vc_font;
+
+extern vc_font system_font;
+
+vc_font *load_font(const char *path);   // NULL if it can't be mapped, or isn't a font
+void unload_font(vc_font *font);
+// the font compileString() and stringWidth() use.  Any number of fonts can be loaded at once; NULL selects the
+// system font:
+void set_font(vc_font *font);
+vc_font *current_font(void);
+int font_glyph(vc_font *font, uint32_t codepoint, glyph_ref *glyph);  // 0 if the font has no such glyph
+
+// Strings are UTF-8.  A byte that isn't part of a valid sequence stands for itself, which keeps the system font's
+// extra glyphs at 0x8a (the bitcoin B) and 0x8b (the degree sign) working; they're at U+20BF and U+00B0 too:
+uint32_t utf8_next(const char **s, const char *end);
+int utf8_length(const char *s, int len);   // in characters
 
-void init_font();
 uint8 pin(int x);
-int char_width(char c);
-uint8 stringWidth(char s[],uint8 scale);
+int font_kerning(uint8 scale, int len);    // len in characters
+uint8 stringWidth(const char *s, int len, uint8 scale);   // len in bytes
 
 #endif
 
@@ -0,0 +1,696 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Generated by font_atlas_gen from the glyph definitions in font.c.  Don't edit this; rebuild it with
+   cc -DFONT_ATLAS_GEN -o font_atlas_gen font.c && ./font_atlas_gen > font_atlas.h
+*/
+
+const seg_or_flag font_atlas[] = {
+
+    {.flag = 0x86},   // 0x20
+
+    {{1, 13, 0, 22, legacy_pos, 0x99}},   // '!'
+    {{1, 1, 2, 2, cir, 0xff}},
+    {.flag = 0x82},
+
+    {{0, 16, 0, 12, legacy_pos, 0x99}},   // '"'
+    {{6, 16, 0, 12, legacy_pos, 0x99}},
+    {.flag = 0x86},
+
+    {{3, 12, 3, 24, legacy_pos, 0x99}},   // '#'
+    {{8, 12, 3, 24, legacy_pos, 0x99}},
+    {{5, 9, 15, 0, legacy_pos, 0x99}},
+    {{6, 15, 15, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{5, 6, 10, 8, cir, 0xf3}},   // '$'
+    {{5, 14, 10, 8, cir, 0x3f}},
+    {{5, 10, 0, 36, legacy_pos, 0x99}},
+    {.flag = 0x8a},
+
+    {{3, 17, 6, 6, cir, 0xff}},   // '%'
+    {{9, 3, 6, 6, cir, 0xff}},
+    {{6, 10, 18, 30, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{4, 15, 8, 10, cir, 0xfe}},   // '&'
+    {{4, 5, 8, 10, cir, 0x0f}},
+    {{4, 8, 16, 16, cir, 0xc0}},
+    {{6, 6, 15, 18, legacy_neg, 0x99}},
+    {.flag = 0x8c},
+
+    {{3, 19, 2, 2, cir, 0xff}},   // '''
+    {{0, 19, 8, 12, cir, 0xc0}},
+    {.flag = 0x84},
+
+    {{4, 10, 8, 20, cir, 0x0f}},   // '('
+    {.flag = 0x84},
+
+    {{0, 10, 8, 20, cir, 0xf0}},   // ')'
+    {.flag = 0x84},
+
+    {{6, 10, 18, 0, legacy_pos, 0x99}},   // '*'
+    {{6, 10, 12, 18, legacy_pos, 0x99}},
+    {{6, 10, 12, 18, legacy_neg, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 10, 18, 0, legacy_pos, 0x99}},   // '+'
+    {{6, 10, 0, 18, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{3, 1, 2, 2, cir, 0xff}},   // ','
+    {{0, 1, 8, 12, cir, 0xc0}},
+    {.flag = 0x84},
+
+    {{6, 10, 18, 0, legacy_pos, 0x99}},   // '-'
+    {.flag = 0x8c},
+
+    {{1, 1, 2, 2, cir, 0xff}},   // '.'
+    {.flag = 0x82},
+
+    {{6, 10, 18, 30, legacy_pos, 0x99}},   // '/'
+    {.flag = 0x8c},
+
+    {{6, 10, 12, 20, cir, 0xff}},   // '0'
+    {.flag = 0x8c},
+
+    {{7, 10, 0, 30, legacy_pos, 0x99}},   // '1'
+    {{5, 18, 6, 6, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 14, 12, 12, cir, 0xfc}},   // '2'
+    {{6, 0, 12, 16, cir, 0x0c}},
+    {{6, 0, 18, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 6, 12, 12, cir, 0xf1}},   // '3'
+    {{6, 20, 10, 16, cir, 0xc0}},
+    {{6, 20, 15, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{8, 10, 0, 30, legacy_pos, 0x99}},   // '4'
+    {{6, 6, 18, 0, legacy_pos, 0x99}},
+    {{4, 13, 12, 22, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 6, 12, 12, cir, 0xf9}},   // '5'
+    {{3, 15, 3, 15, legacy_pos, 0x99}},
+    {{8, 20, 12, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 6, 12, 12, cir, 0xff}},   // '6'
+    {{5, 15, 9, 15, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 10, 18, 30, legacy_pos, 0x99}},   // '7'
+    {{6, 20, 18, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 6, 12, 12, cir, 0xff}},   // '8'
+    {{6, 16, 8, 8, cir, 0xff}},
+    {.flag = 0x8c},
+
+    {{6, 14, 12, 12, cir, 0xff}},   // '9'
+    {{7, 5, 9, 15, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{1, 6, 2, 2, cir, 0xff}},   // ':'
+    {{1, 14, 2, 2, cir, 0xff}},
+    {.flag = 0x82},
+
+    {{3, 14, 2, 2, cir, 0xff}},   // ';'
+    {{3, 6, 2, 2, cir, 0xff}},
+    {{0, 6, 8, 12, cir, 0xc0}},
+    {.flag = 0x84},
+
+    {{6, 14, 18, 12, legacy_pos, 0x99}},   // '<'
+    {{6, 6, 18, 12, legacy_neg, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 13, 18, 0, legacy_pos, 0x99}},   // '='
+    {{6, 7, 18, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 14, 18, 12, legacy_neg, 0x99}},   // '>'
+    {{6, 6, 18, 12, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{5, 14, 10, 10, cir, 0xfc}},   // '?'
+    {{5, 7, 4, 4, cir, 0xcf}},
+    {{5, 1, 2, 2, cir, 0xff}},
+    {.flag = 0x8a},
+
+    {{3, 10, 6, 10, cir, 0xff}},   // '@'
+    {{3, 10, 14, 20, cir, 0xbf}},
+    {{8, 10, 4, 4, cir, 0xc3}},
+    {.flag = 0x8c},
+
+    {{3, 10, 9, 30, legacy_pos, 0x99}},   // 'A'
+    {{9, 10, 9, 30, legacy_neg, 0x99}},
+    {{6, 8, 9, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'B'
+    {{4, 0, 12, 0, legacy_pos, 0x99}},
+    {{4, 10, 12, 0, legacy_pos, 0x99}},
+    {{4, 20, 12, 0, legacy_pos, 0x99}},
+    {{8, 5, 10, 10, cir, 0xf0}},
+    {{8, 15, 10, 10, cir, 0xf0}},
+    {.flag = 0x8c},
+
+    {{7, 10, 14, 20, cir, 0x9f}},   // 'C'
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'D'
+    {{2, 0, 6, 0, legacy_pos, 0x99}},
+    {{2, 20, 6, 0, legacy_pos, 0x99}},
+    {{4, 10, 16, 20, cir, 0xf0}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'E'
+    {{6, 0, 18, 0, legacy_pos, 0x99}},
+    {{4, 10, 12, 0, legacy_pos, 0x99}},
+    {{6, 20, 18, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'F'
+    {{4, 10, 12, 0, legacy_pos, 0x99}},
+    {{6, 20, 18, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{7, 10, 14, 20, cir, 0x9f}},   // 'G'
+    {{11, 5, 0, 9, legacy_pos, 0x99}},
+    {{9, 8, 6, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'H'
+    {{12, 10, 0, 30, legacy_pos, 0x99}},
+    {{6, 10, 18, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{2, 10, 0, 30, legacy_pos, 0x99}},   // 'I'
+    {{2, 0, 9, 0, legacy_pos, 0x99}},
+    {{2, 20, 9, 0, legacy_pos, 0x99}},
+    {.flag = 0x84},
+
+    {{12, 13, 0, 22, legacy_pos, 0x99}},   // 'J'
+    {{6, 6, 12, 12, cir, 0xc3}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'K'
+    {{6, 5, 18, 15, legacy_neg, 0x99}},
+    {{6, 15, 18, 15, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'L'
+    {{6, 0, 18, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'M'
+    {{12, 10, 0, 30, legacy_pos, 0x99}},
+    {{3, 15, 9, 15, legacy_neg, 0x99}},
+    {{9, 15, 9, 15, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'N'
+    {{12, 10, 0, 30, legacy_pos, 0x99}},
+    {{6, 10, 18, 30, legacy_neg, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 10, 12, 20, cir, 0xff}},   // 'O'
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'P'
+    {{4, 10, 12, 0, legacy_pos, 0x99}},
+    {{4, 20, 12, 0, legacy_pos, 0x99}},
+    {{8, 15, 10, 10, cir, 0xf0}},
+    {.flag = 0x8c},
+
+    {{6, 10, 12, 20, cir, 0xff}},   // 'Q'
+    {{10, 3, 6, 9, legacy_neg, 0x99}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'R'
+    {{4, 10, 12, 0, legacy_pos, 0x99}},
+    {{4, 20, 12, 0, legacy_pos, 0x99}},
+    {{8, 15, 10, 10, cir, 0xf0}},
+    {{9, 5, 9, 15, legacy_neg, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 5, 12, 10, cir, 0xf3}},   // 'S'
+    {{6, 15, 12, 10, cir, 0x3f}},
+    {.flag = 0x8c},
+
+    {{6, 10, 0, 30, legacy_pos, 0x99}},   // 'T'
+    {{6, 20, 18, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{0, 13, 0, 22, legacy_pos, 0x99}},   // 'U'
+    {{12, 13, 0, 22, legacy_pos, 0x99}},
+    {{6, 6, 12, 12, cir, 0xc3}},
+    {.flag = 0x8c},
+
+    {{3, 10, 9, 30, legacy_neg, 0x99}},   // 'V'
+    {{9, 10, 9, 30, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'W'
+    {{12, 10, 0, 30, legacy_pos, 0x99}},
+    {{3, 5, 9, 15, legacy_pos, 0x99}},
+    {{9, 5, 9, 15, legacy_neg, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 10, 18, 30, legacy_neg, 0x99}},   // 'X'
+    {{6, 10, 18, 30, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 5, 0, 15, legacy_pos, 0x99}},   // 'Y'
+    {{3, 15, 9, 15, legacy_neg, 0x99}},
+    {{9, 15, 9, 15, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 10, 18, 30, legacy_pos, 0x99}},   // 'Z'
+    {{6, 0, 18, 0, legacy_pos, 0x99}},
+    {{6, 20, 18, 0, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // '['
+    {{2, 0, 6, 0, legacy_pos, 0x99}},
+    {{2, 20, 6, 0, legacy_pos, 0x99}},
+    {.flag = 0x84},
+
+    {{6, 10, 18, 30, legacy_neg, 0x99}},   // 0x5c
+    {.flag = 0x8c},
+
+    {{4, 10, 0, 30, legacy_pos, 0x99}},   // ']'
+    {{2, 0, 6, 0, legacy_pos, 0x99}},
+    {{2, 20, 6, 0, legacy_pos, 0x99}},
+    {.flag = 0x84},
+
+    {{3, 13, 9, 9, legacy_pos, 0x99}},   // '^'
+    {{9, 13, 9, 9, legacy_neg, 0x99}},
+    {.flag = 0x8c},
+
+    {{6, 0, 18, 0, legacy_pos, 0x99}},   // '_'
+    {.flag = 0x8c},
+
+    {{2, 16, 6, 12, legacy_neg, 0x99}},   // '`'
+    {.flag = 0x84},
+
+    {{5, 6, 10, 12, cir, 0xff}},   // 'a'
+    {{10, 6, 0, 18, legacy_pos, 0x99}},
+    {.flag = 0x8a},
+
+    {{5, 6, 10, 12, cir, 0xff}},   // 'b'
+    {{0, 10, 0, 30, legacy_pos, 0x99}},
+    {.flag = 0x8a},
+
+    {{5, 6, 10, 12, cir, 0x9f}},   // 'c'
+    {.flag = 0x88},
+
+    {{5, 6, 10, 12, cir, 0xff}},   // 'd'
+    {{10, 10, 0, 30, legacy_pos, 0x99}},
+    {.flag = 0x8a},
+
+    {{5, 6, 10, 12, cir, 0xbf}},   // 'e'
+    {{5, 6, 15, 0, legacy_pos, 0x99}},
+    {.flag = 0x8a},
+
+    {{7, 16, 6, 8, cir, 0x3c}},   // 'f'
+    {{4, 10, 12, 0, legacy_pos, 0x99}},
+    {{4, 8, 0, 24, legacy_pos, 0x99}},
+    {.flag = 0x8a},
+
+    {{5, 6, 10, 12, cir, 0xff}},   // 'g'
+    {{10, 6, 0, 18, legacy_pos, 0x99}},
+    {{5, 0, 10, 12, cir, 0xc1}},
+    {.flag = 0x8a},
+
+    {{4, 8, 8, 8, cir, 0x3c}},   // 'h'
+    {{0, 10, 0, 30, legacy_pos, 0x99}},
+    {{8, 4, 0, 12, legacy_pos, 0x99}},
+    {.flag = 0x88},
+
+    {{1, 16, 2, 2, cir, 0xff}},   // 'i'
+    {{1, 6, 0, 18, legacy_pos, 0x99}},
+    {.flag = 0x82},
+
+    {{6, 16, 2, 2, cir, 0xff}},   // 'j'
+    {{6, 6, 0, 18, legacy_pos, 0x99}},
+    {{3, 0, 6, 8, cir, 0xc1}},
+    {.flag = 0x88},
+
+    {{0, 10, 0, 30, legacy_pos, 0x99}},   // 'k'
+    {{4, 8, 12, 12, legacy_pos, 0x99}},
+    {{4, 3, 9, 9, legacy_neg, 0x99}},
+    {.flag = 0x88},
+
+    {{1, 10, 0, 30, legacy_pos, 0x99}},   // 'l'
+    {.flag = 0x82},
+
+    {{0, 6, 0, 18, legacy_pos, 0x99}},   // 'm'
+    {{4, 8, 8, 8, cir, 0x3c}},
+    {{8, 4, 0, 12, legacy_pos, 0x99}},
+    {{12, 8, 8, 8, cir, 0x3c}},
+    {{16, 4, 0, 12, legacy_pos, 0x99}},
+    {.flag = 0x90},
+
+    {{0, 6, 0, 18, legacy_pos, 0x99}},   // 'n'
+    {{4, 8, 8, 8, cir, 0x3c}},
+    {{8, 4, 0, 12, legacy_pos, 0x99}},
+    {.flag = 0x88},
+
+    {{5, 6, 10, 12, cir, 0xff}},   // 'o'
+    {.flag = 0x8a},
+
+    {{5, 6, 10, 12, cir, 0xff}},   // 'p'
+    {{0, 3, 0, 24, legacy_pos, 0x99}},
+    {.flag = 0x8a},
+
+    {{5, 6, 10, 12, cir, 0xff}},   // 'q'
+    {{10, 3, 0, 24, legacy_pos, 0x99}},
+    {.flag = 0x8a},
+
+    {{0, 6, 0, 18, legacy_pos, 0x99}},   // 'r'
+    {{5, 6, 10, 12, cir, 0x1c}},
+    {.flag = 0x88},
+
+    {{4, 9, 8, 6, cir, 0x3f}},   // 's'
+    {{4, 3, 8, 6, cir, 0xf3}},
+    {.flag = 0x88},
+
+    {{8, 4, 8, 8, cir, 0x03}},   // 't'
+    {{4, 12, 12, 0, legacy_pos, 0x99}},
+    {{4, 10, 0, 18, legacy_pos, 0x99}},
+    {.flag = 0x88},
+
+    {{8, 6, 0, 18, legacy_pos, 0x99}},   // 'u'
+    {{4, 4, 8, 8, cir, 0xc3}},
+    {{0, 8, 0, 12, legacy_pos, 0x99}},
+    {.flag = 0x88},
+
+    {{2, 6, 6, 18, legacy_neg, 0x99}},   // 'v'
+    {{6, 6, 6, 18, legacy_pos, 0x99}},
+    {.flag = 0x88},
+
+    {{2, 6, 6, 18, legacy_neg, 0x99}},   // 'w'
+    {{6, 6, 6, 18, legacy_pos, 0x99}},
+    {{10, 6, 6, 18, legacy_neg, 0x99}},
+    {{14, 6, 6, 18, legacy_pos, 0x99}},
+    {.flag = 0x90},
+
+    {{4, 6, 12, 18, legacy_neg, 0x99}},   // 'x'
+    {{4, 6, 12, 18, legacy_pos, 0x99}},
+    {.flag = 0x88},
+
+    {{2, 6, 6, 18, legacy_neg, 0x99}},   // 'y'
+    {{6, 6, 6, 18, legacy_pos, 0x99}},
+    {{1, 0, 6, 8, cir, 0xc0}},
+    {.flag = 0x88},
+
+    {{4, 0, 12, 0, legacy_pos, 0x99}},   // 'z'
+    {{4, 12, 12, 0, legacy_pos, 0x99}},
+    {{4, 6, 12, 18, legacy_pos, 0x99}},
+    {.flag = 0x88},
+
+    {{8, 6, 8, 12, cir, 0x03}},   // '{'
+    {{0, 6, 8, 8, cir, 0x30}},
+    {{0, 14, 8, 8, cir, 0xc0}},
+    {{8, 14, 8, 12, cir, 0x0c}},
+    {.flag = 0x88},
+
+    {{1, 10, 0, 36, legacy_pos, 0x99}},   // '|'
+    {.flag = 0x82},
+
+    {{0, 6, 8, 12, cir, 0xc0}},   // '}'
+    {{8, 6, 8, 8, cir, 0x0c}},
+    {{8, 14, 8, 8, cir, 0x03}},
+    {{0, 14, 8, 12, cir, 0x30}},
+    {.flag = 0x88},
+
+    {{3, 12, 6, 4, cir, 0x3c}},   // '~'
+    {{9, 12, 6, 4, cir, 0xc3}},
+    {.flag = 0x8c},
+
+    {{3, 15, 9, 15, legacy_pos, 0x99}},   // 0x7f
+    {{6, 10, 18, 30, legacy_pos, 0x99}},
+    {{9, 5, 9, 15, legacy_pos, 0x99}},
+    {.flag = 0x8c},
+
+    {{2, 19, 6, 0, legacy_pos, 0x99}},   // 0x80
+    {{2, 11, 6, 0, legacy_pos, 0x99}},
+    {{2, 4, 6, 0, legacy_pos, 0x99}},
+    {{0, 11, 0, 23, legacy_pos, 0x99}},
+    {{4, 11, 0, 22, legacy_pos, 0x99}},
+    {{9, 22, 9, 0, legacy_pos, 0x99}},
+    {{9, 18, 9, 0, legacy_pos, 0x99}},
+    {{9, 14, 9, 0, legacy_pos, 0x99}},
+    {{12, 18, 0, 12, legacy_pos, 0x99}},
+    {{17, 22, 9, 0, legacy_pos, 0x99}},
+    {{17, 18, 9, 0, legacy_pos, 0x99}},
+    {{17, 14, 9, 0, legacy_pos, 0x99}},
+    {{20, 18, 0, 12, legacy_pos, 0x99}},
+    {{15, 10, 17, 0, legacy_pos, 0x99}},
+    {{14, 7, 17, 0, legacy_pos, 0x99}},
+    {{14, 4, 17, 0, legacy_pos, 0x99}},
+    {{15, 1, 20, 0, legacy_pos, 0x99}},
+    {{8, 4, 0, 14, legacy_pos, 0x99}},
+    {{14, 5, 0, 14, legacy_pos, 0x99}},
+    {{0, 12, 19, 14, cir, 0x40}},
+    {{15, 11, 2, 3, legacy_pos, 0x81}},
+    {.flag = 0x98},
+
+    {{8, 19, 18, 0, legacy_pos, 0x99}},   // 0x81
+    {{8, 10, 18, 0, legacy_pos, 0x99}},
+    {{8, 18, 0, 0, legacy_pos, 0x99}},
+    {{2, 10, 0, 26, legacy_pos, 0x99}},
+    {{14, 10, 0, 26, legacy_pos, 0x99}},
+    {.flag = 0x93},
+
+    {{9, 20, 14, 0, legacy_pos, 0x99}},   // 0x82
+    {{9, 13, 14, 0, legacy_pos, 0x99}},
+    {{9, 6, 14, 0, legacy_pos, 0x99}},
+    {{4, 13, 0, 21, legacy_pos, 0x99}},
+    {{0, 6, 8, 12, cir, 0xc0}},
+    {{14, 10, 0, 30, legacy_pos, 0x99}},
+    {{13, 0, 3, 0, legacy_pos, 0x81}},
+    {.flag = 0x91},
+
+    {{10, 15, 0, 17, legacy_pos, 0x99}},   // 0x83
+    {{0, 10, 20, 20, cir, 0xc0}},
+    {{20, 10, 20, 20, cir, 0x03}},
+    {{0, 16, 8, 15, cir, 0x40}},
+    {{15, 14, 3, 7, legacy_pos, 0x99}},
+    {.flag = 0x93},
+
+    {{10, 11, 0, 33, legacy_pos, 0x99}},   // 0x84
+    {{9, 0, 3, 0, legacy_pos, 0x81}},
+    {{4, 14, 7, 0, legacy_pos, 0x99}},
+    {{0, 14, 14, 19, cir, 0x40}},
+    {{3, 5, 5, 7, legacy_pos, 0x99}},
+    {{15, 13, 8, 6, legacy_pos, 0x99}},
+    {{27, 19, 34, 33, cir, 0x02}},
+    {{17, 5, 7, 7, legacy_neg, 0x99}},
+    {.flag = 0x94},
+
+    {{10, 11, 0, 34, legacy_pos, 0x99}},   // 0x85
+    {{10, 15, 26, 0, legacy_pos, 0x99}},
+    {{1, 15, 18, 22, cir, 0x40}},
+    {{4, 4, 10, 10, legacy_pos, 0x99}},
+    {{19, 15, 18, 22, cir, 0x02}},
+    {{16, 4, 10, 10, legacy_neg, 0x99}},
+    {.flag = 0x93},
+
+    {{0, 22, 21, 17, cir, 0x40}},   // 0x86
+    {{4, 14, 9, 6, legacy_pos, 0x99}},
+    {{21, 22, 22, 17, cir, 0x02}},
+    {{16, 14, 8, 6, legacy_neg, 0x99}},
+    {{10, 14, 12, 0, legacy_pos, 0x99}},
+    {{10, 9, 25, 0, legacy_pos, 0x99}},
+    {{10, 7, 0, 19, legacy_pos, 0x99}},
+    {{10, 1, 26, 0, legacy_pos, 0x99}},
+    {{3, 3, 8, 10, cir, 0x20}},
+    {{11, 6, 7, 10, cir, 0x40}},
+    {.flag = 0x94},
+
+    {{10, 12, 0, 31, legacy_pos, 0x99}},   // 0x87
+    {{10, 14, 23, 0, legacy_pos, 0x99}},
+    {{10, 2, 28, 0, legacy_pos, 0x99}},
+    {.flag = 0x95},
+
+    {{0, 21, 10, 12, cir, 0x40}},   // 0x88
+    {{2, 16, 4, 4, legacy_pos, 0x99}},
+    {{10, 18, 18, 0, legacy_pos, 0x99}},
+    {{10, 12, 16, 0, legacy_pos, 0x99}},
+    {{9, 6, 26, 0, legacy_pos, 0x99}},
+    {{5, 9, 0, 9, legacy_pos, 0x99}},
+    {{10, 8, 0, 29, legacy_pos, 0x99}},
+    {.flag = 0x92},
+
+    {{28, 19, 37, 32, cir, 0x02}},   // 0x89
+    {.flag = 0x92},
+
+    {{2, 10, 0, 30, legacy_pos, 0x99}},   // 0x8a
+    {{4, 0, 12, 0, legacy_pos, 0x99}},
+    {{4, 10, 12, 0, legacy_pos, 0x99}},
+    {{4, 20, 12, 0, legacy_pos, 0x99}},
+    {{8, 5, 10, 10, cir, 0xf0}},
+    {{8, 15, 10, 10, cir, 0xf0}},
+    {{2, 20, 0, 10, legacy_pos, 0xf0}},
+    {{8, 20, 0, 10, legacy_pos, 0xf0}},
+    {{2, 0, 0, 10, legacy_pos, 0x0f}},
+    {{8, 0, 0, 10, legacy_pos, 0x0f}},
+    {.flag = 0x8c},
+
+    {{4, 18, 5, 5, cir, 0xff}},   // 0x8b
+    {.flag = 0x84},
+};
+
+const int font_atlas_length = 430;
+
+const font_metrics system_metrics = {
+  .glyphs = {
+    {0, 6, 0},   // 0x20
+    {1, 2, 2},   // '!'
+    {4, 6, 2},   // '"'
+    {7, 12, 4},   // '#'
+    {12, 10, 3},   // '$'
+    {16, 12, 3},   // '%'
+    {20, 12, 4},   // '&'
+    {25, 4, 2},   // '''
+    {28, 4, 1},   // '('
+    {30, 4, 1},   // ')'
+    {32, 12, 3},   // '*'
+    {36, 12, 2},   // '+'
+    {39, 4, 2},   // ','
+    {42, 12, 1},   // '-'
+    {44, 2, 1},   // '.'
+    {46, 12, 1},   // '/'
+    {48, 12, 1},   // '0'
+    {50, 12, 2},   // '1'
+    {53, 12, 3},   // '2'
+    {57, 12, 3},   // '3'
+    {61, 12, 3},   // '4'
+    {65, 12, 3},   // '5'
+    {69, 12, 2},   // '6'
+    {72, 12, 2},   // '7'
+    {75, 12, 2},   // '8'
+    {78, 12, 2},   // '9'
+    {81, 2, 2},   // ':'
+    {84, 4, 3},   // ';'
+    {88, 12, 2},   // '<'
+    {91, 12, 2},   // '='
+    {94, 12, 2},   // '>'
+    {97, 10, 3},   // '?'
+    {101, 12, 3},   // '@'
+    {105, 12, 3},   // 'A'
+    {109, 12, 6},   // 'B'
+    {116, 12, 1},   // 'C'
+    {118, 12, 4},   // 'D'
+    {123, 12, 4},   // 'E'
+    {128, 12, 3},   // 'F'
+    {132, 12, 3},   // 'G'
+    {136, 12, 3},   // 'H'
+    {140, 4, 3},   // 'I'
+    {144, 12, 2},   // 'J'
+    {147, 12, 3},   // 'K'
+    {151, 12, 2},   // 'L'
+    {154, 12, 4},   // 'M'
+    {159, 12, 3},   // 'N'
+    {163, 12, 1},   // 'O'
+    {165, 12, 4},   // 'P'
+    {170, 12, 2},   // 'Q'
+    {173, 12, 5},   // 'R'
+    {179, 12, 2},   // 'S'
+    {182, 12, 2},   // 'T'
+    {185, 12, 3},   // 'U'
+    {189, 12, 2},   // 'V'
+    {192, 12, 4},   // 'W'
+    {197, 12, 2},   // 'X'
+    {200, 12, 3},   // 'Y'
+    {204, 12, 3},   // 'Z'
+    {208, 4, 3},   // '['
+    {212, 12, 1},   // 0x5c
+    {214, 4, 3},   // ']'
+    {218, 12, 2},   // '^'
+    {221, 12, 1},   // '_'
+    {223, 4, 1},   // '`'
+    {225, 10, 2},   // 'a'
+    {228, 10, 2},   // 'b'
+    {231, 8, 1},   // 'c'
+    {233, 10, 2},   // 'd'
+    {236, 10, 2},   // 'e'
+    {239, 10, 3},   // 'f'
+    {243, 10, 3},   // 'g'
+    {247, 8, 3},   // 'h'
+    {251, 2, 2},   // 'i'
+    {254, 8, 3},   // 'j'
+    {258, 8, 3},   // 'k'
+    {262, 2, 1},   // 'l'
+    {264, 16, 5},   // 'm'
+    {270, 8, 3},   // 'n'
+    {274, 10, 1},   // 'o'
+    {276, 10, 2},   // 'p'
+    {279, 10, 2},   // 'q'
+    {282, 8, 2},   // 'r'
+    {285, 8, 2},   // 's'
+    {288, 8, 3},   // 't'
+    {292, 8, 3},   // 'u'
+    {296, 8, 2},   // 'v'
+    {299, 16, 4},   // 'w'
+    {304, 8, 2},   // 'x'
+    {307, 8, 3},   // 'y'
+    {311, 8, 3},   // 'z'
+    {315, 8, 4},   // '{'
+    {320, 2, 1},   // '|'
+    {322, 8, 4},   // '}'
+    {327, 12, 2},   // '~'
+    {330, 12, 3},   // 0x7f
+    {334, 24, 21},   // 0x80
+    {356, 19, 5},   // 0x81
+    {362, 17, 7},   // 0x82
+    {370, 19, 5},   // 0x83
+    {376, 20, 8},   // 0x84
+    {385, 19, 6},   // 0x85
+    {392, 20, 10},   // 0x86
+    {403, 21, 3},   // 0x87
+    {407, 18, 7},   // 0x88
+    {415, 18, 1},   // 0x89
+    {417, 12, 10},   // 0x8a
+    {428, 4, 1},   // 0x8b
+    {65535, 0, 0},   // 0x8c
+    {65535, 0, 0},   // 0x8d
+    {65535, 0, 0},   // 0x8e
+    {65535, 0, 0},   // 0x8f
+    {65535, 0, 0},   // 0x90
+    {65535, 0, 0},   // 0x91
+    {65535, 0, 0},   // 0x92
+    {65535, 0, 0},   // 0x93
+    {65535, 0, 0},   // 0x94
+    {65535, 0, 0},   // 0x95
+    {65535, 0, 0},   // 0x96
+    {65535, 0, 0},   // 0x97
+    {65535, 0, 0},   // 0x98
+    {65535, 0, 0},   // 0x99
+    {65535, 0, 0},   // 0x9a
+    {65535, 0, 0},   // 0x9b
+    {65535, 0, 0},   // 0x9c
+    {65535, 0, 0},   // 0x9d
+    {65535, 0, 0},   // 0x9e
+    {65535, 0, 0},   // 0x9f
+  },
+  .kerning = {4, 4, 4, 3, 4, 5},
+  .short_length = 6,
+  .short_extra = 2,
+};
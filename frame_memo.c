@@ -0,0 +1,79 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Whole-frame memoization.  There's only one main buffer, so only the most recent frame is remembered; the key
+ holds each declared input separately, so two different frames can never be mistaken for each other.
+*/
+
+#include <stdio.h>
+#include "frame_memo.h"
+
+typedef struct {
+  int mode;
+  long quantum;             // now, or now / 60, or 0, depending on the mode's inputs
+  unsigned long location;
+  unsigned long data_version;
+} memo_key;
+
+static memo_key last_key;
+static int last_valid = 0;
+static int last_sent = 0;
+
+int frame_memo_lookup(frame_memo *memo, int mode, time_t now, unsigned long location){
+  memo_key key = {mode, 0, 0, 0};
+
+  if(memo->inputs & MEMO_SECOND)
+    key.quantum = now;
+  else if(memo->inputs & MEMO_MINUTE)
+    key.quantum = now / 60;
+  if(memo->inputs & MEMO_LOCATION)
+    key.location = location;
+  if((memo->inputs & MEMO_DATA) && memo->data_version)
+    key.data_version = *memo->data_version;
+
+  if(!(memo->inputs & MEMO_ANIMATED) && last_valid && last_key.mode == key.mode && last_key.quantum == key.quantum &&
+     last_key.location == key.location && last_key.data_version == key.data_version){
+    memo->hits++;
+    return 1;
+  }
+
+  memo->misses++;
+  last_key = key;
+  last_valid = !(memo->inputs & MEMO_ANIMATED);
+  last_sent = 0;
+  return 0;
+}
+
+void frame_memo_sent(void){
+  last_sent = 1;
+}
+int frame_memo_needs_send(void){
+  return !last_sent;
+}
+
+void frame_memo_invalidate(void){
+  last_valid = 0;
+  last_sent = 0;
+}
+
+void frame_memo_report(frame_memo *memos, int n_modes){
+  int mode;
+
+  for(mode = 0; mode < n_modes; mode++){
+    unsigned long frames = memos[mode].hits + memos[mode].misses;
+
+    if(frames)
+      printf("mode %d: %lu of %lu frames reused (%.1f%%)\r\n", mode, memos[mode].hits, frames, 100.0 * memos[mode].hits / frames);
+  }
+}
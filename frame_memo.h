@@ -0,0 +1,49 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Whole-frame memoization.  Each mode declares what its output depends on, and as long as none of that has changed
+ since the last frame, the main loop keeps the finished display list it already has (and has already sent).
+*/
+
+#ifndef frame_memo_h
+#define frame_memo_h
+
+#include <time.h>
+
+// the inputs a mode can depend on.  A mode that declares none is drawn once and then reused:
+#define MEMO_ANIMATED 0x01  // changes every frame, so never reuse it
+#define MEMO_SECOND   0x02
+#define MEMO_MINUTE   0x04
+#define MEMO_LOCATION 0x08
+#define MEMO_DATA     0x10  // *data_version, bumped by whoever updates the data
+
+typedef struct {
+  unsigned inputs;
+  volatile unsigned long *data_version;
+  unsigned long hits, misses;
+} frame_memo;
+
+// returns 1 if the last frame rendered is still good for mode, so rendering can be skipped.  location is any
+// value that changes when the location does.  On a miss the caller renders, and the new frame becomes the memo:
+int frame_memo_lookup(frame_memo *memo, int mode, time_t now, unsigned long location);
+// the frame has (or hasn't yet) been sent to the remote:
+void frame_memo_sent(void);
+int frame_memo_needs_send(void);
+// forget the memo, e.g. when something else has drawn into the main buffer:
+void frame_memo_invalidate(void);
+
+// prints the hit rate of each mode:
+void frame_memo_report(frame_memo *memos, int n_modes);
+
+#endif
@@ -0,0 +1,93 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Table-driven trig.  A quarter wave of sine is stored at 256 steps and interpolated linearly, which is good to
+ about 1 part in 16384 -- far finer than a pixel at any radius the screen can hold -- and needs no libm.
+*/
+
+#include "render_math.h"
+
+// sin(90 degrees * i / 256) in Q1.14, for i = 0..256:
+static const int16_t quarter_sine[257] = {
+      0,   101,   201,   302,   402,   503,   603,   704,   804,   904,  1005,  1105,
+   1205,  1306,  1406,  1506,  1606,  1706,  1806,  1906,  2006,  2105,  2205,  2305,
+   2404,  2503,  2603,  2702,  2801,  2900,  2999,  3098,  3196,  3295,  3393,  3492,
+   3590,  3688,  3786,  3883,  3981,  4078,  4176,  4273,  4370,  4467,  4563,  4660,
+   4756,  4852,  4948,  5044,  5139,  5235,  5330,  5425,  5520,  5614,  5708,  5803,
+   5897,  5990,  6084,  6177,  6270,  6363,  6455,  6547,  6639,  6731,  6823,  6914,
+   7005,  7096,  7186,  7276,  7366,  7456,  7545,  7635,  7723,  7812,  7900,  7988,
+   8076,  8163,  8250,  8337,  8423,  8509,  8595,  8680,  8765,  8850,  8935,  9019,
+   9102,  9186,  9269,  9352,  9434,  9516,  9598,  9679,  9760,  9841,  9921, 10001,
+  10080, 10159, 10238, 10316, 10394, 10471, 10549, 10625, 10702, 10778, 10853, 10928,
+  11003, 11077, 11151, 11224, 11297, 11370, 11442, 11514, 11585, 11656, 11727, 11797,
+  11866, 11935, 12004, 12072, 12140, 12207, 12274, 12340, 12406, 12472, 12537, 12601,
+  12665, 12729, 12792, 12854, 12916, 12978, 13039, 13100, 13160, 13219, 13279, 13337,
+  13395, 13453, 13510, 13567, 13623, 13678, 13733, 13788, 13842, 13896, 13949, 14001,
+  14053, 14104, 14155, 14206, 14256, 14305, 14354, 14402, 14449, 14497, 14543, 14589,
+  14635, 14680, 14724, 14768, 14811, 14854, 14896, 14937, 14978, 15019, 15059, 15098,
+  15137, 15175, 15213, 15250, 15286, 15322, 15357, 15392, 15426, 15460, 15493, 15525,
+  15557, 15588, 15619, 15649, 15679, 15707, 15736, 15763, 15791, 15817, 15843, 15868,
+  15893, 15917, 15941, 15964, 15986, 16008, 16029, 16049, 16069, 16088, 16107, 16125,
+  16143, 16160, 16176, 16192, 16207, 16221, 16235, 16248, 16261, 16273, 16284, 16295,
+  16305, 16315, 16324, 16332, 16340, 16347, 16353, 16359, 16364, 16369, 16373, 16376,
+  16379, 16381, 16383, 16384, 16384
+};
+
+int16_t fast_sin(vc_angle a){
+  int position = a & 0x3fff;    // how far into the quarter turn
+  int index, fraction, value;
+
+  if(a & ANGLE_QUARTER_TURN)
+    position = ANGLE_QUARTER_TURN - position;   // the second and fourth quarters run backwards
+
+  index = position >> 6;        // 256 table steps per quarter..
+  fraction = position & 0x3f;   // ..and 64 angles between each
+  value = quarter_sine[index];
+  if(fraction)
+    value += ((quarter_sine[index + 1] - value) * fraction) >> 6;
+
+  return (a & ANGLE_HALF_TURN) ? -value : value;
+}
+
+int16_t fast_cos(vc_angle a){
+  return fast_sin((vc_angle)(a + ANGLE_QUARTER_TURN));
+}
+
+void fast_sincos(vc_angle a, int16_t *s, int16_t *c){
+  *s = fast_sin(a);
+  *c = fast_sin((vc_angle)(a + ANGLE_QUARTER_TURN));
+}
+
+// scales a Q1.14 trig value by a fixed point length, rounding to the nearest step:
+static vc_coord scale_trig(vc_coord length, int16_t trig){
+  int32_t product = (int32_t)length * trig;
+
+  return (product + (1 << 13)) >> 14;
+}
+
+void polar_fx(vc_coord cx, vc_coord cy, vc_coord radius, vc_angle a, vc_coord *x, vc_coord *y){
+  int16_t s, c;
+
+  fast_sincos(a, &s, &c);
+  *x = cx + scale_trig(radius, c);
+  *y = cy + scale_trig(radius, s);
+}
+
+void dial_fx(vc_coord cx, vc_coord cy, vc_coord radius, vc_angle a, vc_coord *x, vc_coord *y){
+  int16_t s, c;
+
+  fast_sincos(a, &s, &c);
+  *x = cx + scale_trig(radius, s);
+  *y = cy + scale_trig(radius, c);
+}
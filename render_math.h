@@ -0,0 +1,47 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Fast trig for render-time geometry, where results only need to be good to a fraction of a pixel.
+*/
+
+#ifndef render_math_h
+#define render_math_h
+
+#include <stdint.h>
+#include "draw.h"
+
+// Angles are fractions of a turn: 65536 is all the way around, and arithmetic wraps the way angles do.
+// Positive angles are counter-clockwise from +x:
+typedef uint16_t vc_angle;
+
+#define ANGLE_QUARTER_TURN 0x4000
+#define ANGLE_HALF_TURN 0x8000
+#define ANGLE_TURNS(f) ((vc_angle)(int32_t)((f) * 65536.0))              // fractional turns, e.g. 0.25
+#define ANGLE_DEGREES(d) ((vc_angle)(int32_t)((d) * 65536.0 / 360.0))
+#define ANGLE_RADIANS(r) ((vc_angle)(int32_t)((r) * 65536.0 / 6.283185307179586))
+#define ANGLE_PART(n, d) ((vc_angle)(((int32_t)(n) << 16) / (d)))        // n/d of a turn, in integers
+
+// sines and cosines in Q1.14, so TRIG_ONE is 1.0:
+#define TRIG_ONE 16384
+
+int16_t fast_sin(vc_angle a);
+int16_t fast_cos(vc_angle a);
+void fast_sincos(vc_angle a, int16_t *s, int16_t *c);
+
+// the point radius away from (cx,cy) at angle a, all in vc_coord fixed point:
+void polar_fx(vc_coord cx, vc_coord cy, vc_coord radius, vc_angle a, vc_coord *x, vc_coord *y);
+// the same, but with the angle measured clockwise from 12 o'clock, as on a dial:
+void dial_fx(vc_coord cx, vc_coord cy, vc_coord radius, vc_angle a, vc_coord *x, vc_coord *y);
+
+#endif
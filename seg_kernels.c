@@ -0,0 +1,287 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Batch transforms over runs of segments.
+
+ A vc_segment is 6 packed bytes, so 8 segments fill exactly three 16 byte vectors.  Each kernel builds a 48 byte
+ pattern holding one value per field (e.g. {dx,dy,0,0,0,0} repeated for offset), and applies it to whole blocks
+ of 8 segments with saturating byte arithmetic.  The pattern is 0 (or 1 for scale) in the arc_type and mask
+ positions, which leaves them untouched.  Whatever doesn't fill a block is done by the scalar code.
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include "seg_kernels.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SEG_SIMD "SSE2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SEG_SIMD "NEON"
+#endif
+
+// the binary layout of vc_segment is shared with the bare metal side, and the kernels depend on it:
+_Static_assert(sizeof(vc_segment) == 6, "vc_segment must be 6 packed bytes");
+
+#define BLOCK_SEGS 8
+#define BLOCK_BYTES (BLOCK_SEGS * 6)
+
+static uint8 sat(int x){
+  if(x<0) return 0;
+  if(x>255) return 255;
+  return x;
+}
+
+void seg_scale_scalar(vc_segment *segs, int n, uint8 scale){
+  while(n-- > 0){
+    segs->x_offset = sat(scale*segs->x_offset);
+    segs->y_offset = sat(scale*segs->y_offset);
+    segs->x_size = sat(scale*segs->x_size);
+    segs->y_size = sat(scale*segs->y_size);
+    segs++;
+  }
+}
+
+void seg_offset_scalar(vc_segment *segs, int n, int dx, int dy){
+  while(n-- > 0){
+    segs->x_offset = sat(segs->x_offset + dx);
+    segs->y_offset = sat(segs->y_offset + dy);
+    segs++;
+  }
+}
+
+void seg_inset_scalar(vc_segment *segs, int n, uint8 dx, uint8 dy){
+  while(n-- > 0){
+    segs->x_size = sat(segs->x_size - dx);
+    segs->y_size = sat(segs->y_size - dy);
+    segs++;
+  }
+}
+
+#ifdef SEG_SIMD
+
+// repeats one 6 byte field pattern across a whole block:
+static void fill_pattern(uint8 *pattern, uint8 x_offset, uint8 y_offset, uint8 x_size, uint8 y_size, uint8 arc_type, uint8 mask){
+  uint8 fields[6] = {x_offset, y_offset, x_size, y_size, arc_type, mask};
+  int i;
+
+  for(i=0;i<BLOCK_BYTES;i++) pattern[i] = fields[i % 6];
+}
+
+#if defined(__SSE2__)
+
+// adds add_pat, then subtracts sub_pat, saturating at 0 and 255:
+static void add_sub_blocks(uint8 *bytes, int n_blocks, uint8 *add_pat, uint8 *sub_pat){
+  __m128i a0 = _mm_loadu_si128((__m128i *)add_pat);
+  __m128i a1 = _mm_loadu_si128((__m128i *)(add_pat + 16));
+  __m128i a2 = _mm_loadu_si128((__m128i *)(add_pat + 32));
+  __m128i s0 = _mm_loadu_si128((__m128i *)sub_pat);
+  __m128i s1 = _mm_loadu_si128((__m128i *)(sub_pat + 16));
+  __m128i s2 = _mm_loadu_si128((__m128i *)(sub_pat + 32));
+
+  while(n_blocks-- > 0){
+    __m128i v0 = _mm_loadu_si128((__m128i *)bytes);
+    __m128i v1 = _mm_loadu_si128((__m128i *)(bytes + 16));
+    __m128i v2 = _mm_loadu_si128((__m128i *)(bytes + 32));
+    v0 = _mm_subs_epu8(_mm_adds_epu8(v0,a0),s0);
+    v1 = _mm_subs_epu8(_mm_adds_epu8(v1,a1),s1);
+    v2 = _mm_subs_epu8(_mm_adds_epu8(v2,a2),s2);
+    _mm_storeu_si128((__m128i *)bytes,v0);
+    _mm_storeu_si128((__m128i *)(bytes + 16),v1);
+    _mm_storeu_si128((__m128i *)(bytes + 32),v2);
+    bytes += BLOCK_BYTES;
+  }
+}
+
+// SSE2 has no unsigned 16 bit saturation, so a product must stay below 32768 to survive _mm_packus_epi16:
+#define MAX_SIMD_SCALE 128
+
+static __m128i mul_vector(__m128i v, __m128i p){
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(v,zero),_mm_unpacklo_epi8(p,zero));
+  __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(v,zero),_mm_unpackhi_epi8(p,zero));
+  return _mm_packus_epi16(lo,hi);
+}
+
+static void mul_blocks(uint8 *bytes, int n_blocks, uint8 *mul_pat){
+  __m128i p0 = _mm_loadu_si128((__m128i *)mul_pat);
+  __m128i p1 = _mm_loadu_si128((__m128i *)(mul_pat + 16));
+  __m128i p2 = _mm_loadu_si128((__m128i *)(mul_pat + 32));
+
+  while(n_blocks-- > 0){
+    _mm_storeu_si128((__m128i *)bytes,mul_vector(_mm_loadu_si128((__m128i *)bytes),p0));
+    _mm_storeu_si128((__m128i *)(bytes + 16),mul_vector(_mm_loadu_si128((__m128i *)(bytes + 16)),p1));
+    _mm_storeu_si128((__m128i *)(bytes + 32),mul_vector(_mm_loadu_si128((__m128i *)(bytes + 32)),p2));
+    bytes += BLOCK_BYTES;
+  }
+}
+
+#else  // NEON
+
+static void add_sub_blocks(uint8 *bytes, int n_blocks, uint8 *add_pat, uint8 *sub_pat){
+  uint8x16_t a0 = vld1q_u8(add_pat), a1 = vld1q_u8(add_pat + 16), a2 = vld1q_u8(add_pat + 32);
+  uint8x16_t s0 = vld1q_u8(sub_pat), s1 = vld1q_u8(sub_pat + 16), s2 = vld1q_u8(sub_pat + 32);
+
+  while(n_blocks-- > 0){
+    vst1q_u8(bytes,vqsubq_u8(vqaddq_u8(vld1q_u8(bytes),a0),s0));
+    vst1q_u8(bytes + 16,vqsubq_u8(vqaddq_u8(vld1q_u8(bytes + 16),a1),s1));
+    vst1q_u8(bytes + 32,vqsubq_u8(vqaddq_u8(vld1q_u8(bytes + 32),a2),s2));
+    bytes += BLOCK_BYTES;
+  }
+}
+
+// vmull_u8 widens to 16 bits, so every scale saturates correctly:
+#define MAX_SIMD_SCALE 255
+
+static uint8x16_t mul_vector(uint8x16_t v, uint8x16_t p){
+  uint16x8_t lo = vmull_u8(vget_low_u8(v),vget_low_u8(p));
+  uint16x8_t hi = vmull_u8(vget_high_u8(v),vget_high_u8(p));
+  return vcombine_u8(vqmovn_u16(lo),vqmovn_u16(hi));
+}
+
+static void mul_blocks(uint8 *bytes, int n_blocks, uint8 *mul_pat){
+  uint8x16_t p0 = vld1q_u8(mul_pat), p1 = vld1q_u8(mul_pat + 16), p2 = vld1q_u8(mul_pat + 32);
+
+  while(n_blocks-- > 0){
+    vst1q_u8(bytes,mul_vector(vld1q_u8(bytes),p0));
+    vst1q_u8(bytes + 16,mul_vector(vld1q_u8(bytes + 16),p1));
+    vst1q_u8(bytes + 32,mul_vector(vld1q_u8(bytes + 32),p2));
+    bytes += BLOCK_BYTES;
+  }
+}
+
+#endif
+
+void seg_scale(vc_segment *segs, int n, uint8 scale){
+  uint8 mul_pat[BLOCK_BYTES];
+  int n_blocks = n / BLOCK_SEGS;
+
+  if(scale > MAX_SIMD_SCALE) n_blocks = 0;
+  if(n_blocks){
+    fill_pattern(mul_pat,scale,scale,scale,scale,1,1);
+    mul_blocks((uint8 *)segs,n_blocks,mul_pat);
+  }
+  seg_scale_scalar(segs + n_blocks*BLOCK_SEGS,n - n_blocks*BLOCK_SEGS,scale);
+}
+
+void seg_offset(vc_segment *segs, int n, int dx, int dy){
+  uint8 add_pat[BLOCK_BYTES], sub_pat[BLOCK_BYTES];
+  int n_blocks = n / BLOCK_SEGS;
+
+  if(n_blocks){
+    fill_pattern(add_pat,dx>0 ? sat(dx) : 0,dy>0 ? sat(dy) : 0,0,0,0,0);
+    fill_pattern(sub_pat,dx<0 ? sat(-dx) : 0,dy<0 ? sat(-dy) : 0,0,0,0,0);
+    add_sub_blocks((uint8 *)segs,n_blocks,add_pat,sub_pat);
+  }
+  seg_offset_scalar(segs + n_blocks*BLOCK_SEGS,n - n_blocks*BLOCK_SEGS,dx,dy);
+}
+
+void seg_inset(vc_segment *segs, int n, uint8 dx, uint8 dy){
+  uint8 add_pat[BLOCK_BYTES], sub_pat[BLOCK_BYTES];
+  int n_blocks = n / BLOCK_SEGS;
+
+  if(n_blocks){
+    fill_pattern(add_pat,0,0,0,0,0,0);
+    fill_pattern(sub_pat,0,0,dx,dy,0,0);
+    add_sub_blocks((uint8 *)segs,n_blocks,add_pat,sub_pat);
+  }
+  seg_inset_scalar(segs + n_blocks*BLOCK_SEGS,n - n_blocks*BLOCK_SEGS,dx,dy);
+}
+
+#else  // no SIMD on this target
+
+#define SEG_SIMD "none"
+
+void seg_scale(vc_segment *segs, int n, uint8 scale){
+  seg_scale_scalar(segs,n,scale);
+}
+
+void seg_offset(vc_segment *segs, int n, int dx, int dy){
+  seg_offset_scalar(segs,n,dx,dy);
+}
+
+void seg_inset(vc_segment *segs, int n, uint8 dx, uint8 dy){
+  seg_inset_scalar(segs,n,dx,dy);
+}
+
+#endif
+
+/* ************* Microbenchmark ************* */
+
+#define BENCH_SEGS 300    // one full frame's worth
+
+static unsigned long bench_nanoseconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+static void bench_fill(vc_segment *segs){
+  int i;
+  for(i=0;i<BENCH_SEGS;i++){
+    segs[i].x_offset = (i * 37) & 0xff;
+    segs[i].y_offset = (i * 11) & 0xff;
+    segs[i].x_size = (i * 5) & 0x7f;
+    segs[i].y_size = (i * 3) & 0x7f;
+    segs[i].arc_type = i % (lissajou5 + 1);
+    segs[i].mask = 0x99;
+  }
+}
+
+// one signature for every kernel, so they can all be timed by the same loop:
+typedef void (*bench_kernel)(vc_segment *segs, int n, int amount);
+
+static void bench_offset(vc_segment *segs, int n, int amount){ seg_offset(segs,n,amount,-amount); }
+static void bench_offset_scalar(vc_segment *segs, int n, int amount){ seg_offset_scalar(segs,n,amount,-amount); }
+static void bench_inset(vc_segment *segs, int n, int amount){ seg_inset(segs,n,amount,amount); }
+static void bench_inset_scalar(vc_segment *segs, int n, int amount){ seg_inset_scalar(segs,n,amount,amount); }
+static void bench_scale(vc_segment *segs, int n, int amount){ seg_scale(segs,n,amount); }
+static void bench_scale_scalar(vc_segment *segs, int n, int amount){ seg_scale_scalar(segs,n,amount); }
+
+// returns nanoseconds per frame-sized run.  Alternating the two amounts keeps the data from saturating and staying there:
+static unsigned long bench(bench_kernel kernel, int amount0, int amount1, int iterations){
+  static vc_segment segs[BENCH_SEGS];
+  unsigned long t0;
+  int i;
+
+  bench_fill(segs);
+  t0 = bench_nanoseconds();
+  for(i=0;i<iterations;i++){
+    kernel(segs,BENCH_SEGS,amount0);
+    kernel(segs,BENCH_SEGS,amount1);
+  }
+  return (bench_nanoseconds() - t0) / (2UL * iterations);
+}
+
+void seg_kernels_benchmark(int iterations){
+  static vc_segment segs[BENCH_SEGS], check[BENCH_SEGS];
+
+  if(iterations < 1) iterations = 1;
+  printf("segment kernels: %d segments, %d iterations, SIMD = %s\n",BENCH_SEGS,iterations,SEG_SIMD);
+  printf("  offset: %6lu ns (simd)  %6lu ns (scalar)\n",bench(bench_offset,3,-3,iterations),bench(bench_offset_scalar,3,-3,iterations));
+  printf("  inset:  %6lu ns (simd)  %6lu ns (scalar)\n",bench(bench_inset,1,0,iterations),bench(bench_inset_scalar,1,0,iterations));
+  printf("  scale:  %6lu ns (simd)  %6lu ns (scalar)\n",bench(bench_scale,2,1,iterations),bench(bench_scale_scalar,2,1,iterations));
+
+  // make sure both paths agree, including the bytes that must pass through untouched:
+  bench_fill(segs);
+  bench_fill(check);
+  seg_scale(segs,BENCH_SEGS,3);
+  seg_offset(segs,BENCH_SEGS,-20,45);
+  seg_inset(segs,BENCH_SEGS,7,200);
+  seg_scale_scalar(check,BENCH_SEGS,3);
+  seg_offset_scalar(check,BENCH_SEGS,-20,45);
+  seg_inset_scalar(check,BENCH_SEGS,7,200);
+  printf("  results %s\n",memcmp(segs,check,sizeof(segs)) ? "DIFFER" : "match");
+}
@@ -0,0 +1,39 @@
+/*
+
+ Copyright (C) 2016-2021 Michael Boich
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ Batch transforms over runs of segments (no sentinel).  All arithmetic saturates to 0..255 the way pin() does,
+ and the arc_type and mask bytes are never touched.  SSE2 or NEON is used when the compiler targets it.
+*/
+
+#ifndef seg_kernels_h
+#define seg_kernels_h
+
+#include "font.h"
+
+// multiplies x_offset, y_offset, x_size and y_size by scale:
+void seg_scale(vc_segment *segs, int n, uint8 scale);
+// adds dx, dy (which may be negative) to x_offset and y_offset:
+void seg_offset(vc_segment *segs, int n, int dx, int dy);
+// subtracts dx, dy from x_size and y_size:
+void seg_inset(vc_segment *segs, int n, uint8 dx, uint8 dy);
+
+// the plain C versions, used for the tail of each run and on targets without SIMD:
+void seg_scale_scalar(vc_segment *segs, int n, uint8 scale);
+void seg_offset_scalar(vc_segment *segs, int n, int dx, int dy);
+void seg_inset_scalar(vc_segment *segs, int n, uint8 dx, uint8 dy);
+
+// times the vector kernels against the scalar ones and prints the results:
+void seg_kernels_benchmark(int iterations);
+
+#endif
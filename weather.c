@@ -46,6 +46,12 @@ double current_humidity = 0;
 double current_baro = 0.0;
 char *current_last_updated = "no info";
 char *current_condition = "no info";
+volatile unsigned long weather_version = 0;    // bumped each time new weather data is parsed
+
+// the condition and update time can be wider than the screen, so they scroll:
+static marquee condition_marquee, updated_marquee;
+#define WEATHER_MARQUEE_LEFT 4
+#define WEATHER_MARQUEE_RIGHT 251
 
 //Update weather info every this-many-seconds:
 #define WEATHER_INTERVAL 300
@@ -96,6 +102,7 @@ void parse_weather_payload()
   condition_text = cJSON_GetObjectItemCaseSensitive(condition_JSON, "text");
   current_condition = condition_text->valuestring;
   debugMsg("Current condition = %s\n", current_condition);
+  weather_version++;
 }
 
 void render_current_weather(time_t now, struct tm *local_bdt, struct tm *utc_bdt)
@@ -104,22 +111,30 @@ void render_current_weather(time_t now, struct tm *local_bdt, struct tm *utc_bdt
 
   sem_wait(&curl_mutex);
   sprintf(temperature_str, "Temp %.0f\x8b", current_temp_f); // \x8b is the degree symbol which I arbitrarily added to the character set at decimal 139
-  compileString(temperature_str, 255, 120, MAIN_BUFFER, 2, OVERWRITE);
+  drawText(temperature_str, 255, 120, MAIN_BUFFER, 2, OVERWRITE);
 
   sprintf(humidity_str, "Humidity %.0f%%", current_humidity); // i learned that "%%" escapes to "%" in formatted print statements :-)
-  compileString(humidity_str, 255, 192, MAIN_BUFFER, 1, APPEND);
+  drawText(humidity_str, 255, 192, MAIN_BUFFER, 1, APPEND);
 
   sprintf(baro_str, "Barometer %.2f", current_baro);
-  compileString(baro_str, 255, 64, MAIN_BUFFER, 1, APPEND);
+  drawText(baro_str, 255, 64, MAIN_BUFFER, 1, APPEND);
 
   sprintf(baro_str, "Updated: %s", current_last_updated);
-  compileString(current_last_updated, 255, 32, MAIN_BUFFER, 1, APPEND);
+  set_marquee(&updated_marquee, baro_str, 32, 1, WEATHER_MARQUEE_LEFT, WEATHER_MARQUEE_RIGHT);
 
-  compileString(current_condition, 255, 230, MAIN_BUFFER, 1, APPEND);
+  set_marquee(&condition_marquee, current_condition, 230, 1, WEATHER_MARQUEE_LEFT, WEATHER_MARQUEE_RIGHT);
 
   sem_post(&curl_mutex);
 }
 
+// draws the scrolling lines into AUX_BUFFER, every frame:
+void animate_current_weather(unsigned long now_ms)
+{
+  clear_buffer(AUX_BUFFER);
+  draw_marquee(&updated_marquee, now_ms, AUX_BUFFER);
+  draw_marquee(&condition_marquee, now_ms, AUX_BUFFER);
+}
+
 size_t weather_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
 {
   //fprintf(stderr, "wx write_callback\n");
@@ -13,5 +13,8 @@
  GNU General Public License for more details.
 */
 
+extern volatile unsigned long weather_version;
+
 void *weather_thread(void *arg);
 void render_current_weather(time_t now, struct tm *local_bdt, struct tm *utc_bdt);
+void animate_current_weather(unsigned long now_ms);